@@ -9,6 +9,9 @@ public class ActionRPGTarget : TargetRules
 	{
 		Type = TargetType.Game;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
+		//push model changes the engine build, which needs a unique build environment and so a source engine
+		BuildEnvironment = TargetBuildEnvironment.Unique;
+		bWithPushModel = true;
 		ExtraModuleNames.Add("ActionRPG");
 	}
 }
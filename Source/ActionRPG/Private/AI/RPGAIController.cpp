@@ -3,9 +3,140 @@
 
 #include "AI/RPGAIController.h"
 #include "AI/RPGPathFollowingComponent.h"
+#include "AI/RPGPathRequestSubsystem.h"
+#include "AI/RPGFlowFieldSubsystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
 
 ARPGAIController::ARPGAIController(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer.SetDefaultSubobjectClass<URPGPathFollowingComponent>(TEXT("PathFollowingComponent")))
 {
+	bUseAsyncPathfinding = true;
+	AvoidanceMode = ERPGAvoidanceMode::SpatialGrid;
+}
+
+void ARPGAIController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	ApplyAvoidanceMode();
+}
+
+void ARPGAIController::SetAvoidanceMode(ERPGAvoidanceMode NewAvoidanceMode)
+{
+	AvoidanceMode = NewAvoidanceMode;
+	ApplyAvoidanceMode();
+}
+
+void ARPGAIController::ApplyAvoidanceMode()
+{
+	if (URPGPathFollowingComponent* RPGPathFollowing = Cast<URPGPathFollowingComponent>(GetPathFollowingComponent()))
+	{
+		RPGPathFollowing->SetGridAvoidanceEnabled(AvoidanceMode == ERPGAvoidanceMode::SpatialGrid);
+	}
+
+	//only one of the two, they would fight over the velocity
+	const ACharacter* Character = Cast<ACharacter>(GetPawn());
+	if (UCharacterMovementComponent* CharacterMovement = Character ? Character->GetCharacterMovement() : nullptr)
+	{
+		CharacterMovement->SetAvoidanceEnabled(AvoidanceMode == ERPGAvoidanceMode::CharacterMovementRVO);
+	}
+}
+
+void ARPGAIController::FindPathForMoveRequest(const FAIMoveRequest& MoveRequest, FPathFindingQuery& Query, FNavPathSharedPtr& OutPath) const
+{
+	const ANavigationData* NavData = Query.NavData.Get();
+
+	//chasing an actor with a flow field doesn't need a search, the path is only there for the path following state and the goal
+	URPGPathFollowingComponent* RPGPathFollowing = Cast<URPGPathFollowingComponent>(GetPathFollowingComponent());
+	if (RPGPathFollowing && RPGPathFollowing->UsesFlowField() && MoveRequest.IsMoveToActorRequest() && MoveRequest.IsUsingPathfinding() && FindFlowFieldPath(MoveRequest, Query, OutPath))
+	{
+		return;
+	}
+
+	URPGPathRequestSubsystem* PathRequests = GetWorld()->GetSubsystem<URPGPathRequestSubsystem>();
+
+	//after a blocked or partial move, no path (the move request fails) until the backoff is over and there's quota left this frame
+	if (RPGPathFollowing && MoveRequest.IsUsingPathfinding())
+	{
+		if (!RPGPathFollowing->CanRequestPath())
+		{
+			return;
+		}
+
+		if (RPGPathFollowing->GetConsecutivePathFailures() > 0 && PathRequests && !PathRequests->ConsumeRepathQuota())
+		{
+			return;
+		}
+	}
+
+	//only navmesh paths are filled by the batch
+	if (!bUseAsyncPathfinding || !PathRequests || !Cast<const ARecastNavMesh>(NavData) || !MoveRequest.IsUsingPathfinding())
+	{
+		Super::FindPathForMoveRequest(MoveRequest, Query, OutPath);
+
+		if (RPGPathFollowing && MoveRequest.IsUsingPathfinding() && !OutPath.IsValid())
+		{
+			RPGPathFollowing->RegisterPathFailure();
+		}
+		return;
+	}
+
+	FNavPathSharedPtr PendingPath = NavData->CreatePathInstance<FNavMeshPath>(Query);
+	if (!PendingPath.IsValid())
+	{
+		return;
+	}
+
+	//chasing an actor keeps the path updated like the synchronous path, but the repaths go in the batch too
+	//the navigation data only keeps the goal actor, its own observation would repath on the game thread
+	if (MoveRequest.IsMoveToActorRequest())
+	{
+		PendingPath->SetGoalActorObservation(*MoveRequest.GetGoalActor(), WORLD_MAX);
+		PathRequests->ObservePath(PendingPath, GetPathFollowingComponent(), 100.0f);
+	}
+
+	PendingPath->EnableRecalculationOnInvalidation(true);
+
+	PathRequests->RequestPath(Query, PendingPath, GetPathFollowingComponent());
+	OutPath = PendingPath;
+}
+
+bool ARPGAIController::FindFlowFieldPath(const FAIMoveRequest& MoveRequest, const FPathFindingQuery& Query, FNavPathSharedPtr& OutPath) const
+{
+	URPGFlowFieldSubsystem* FlowFields = GetWorld()->GetSubsystem<URPGFlowFieldSubsystem>();
+	const ARecastNavMesh* NavMesh = Cast<const ARecastNavMesh>(Query.NavData.Get());
+	AActor* GoalActor = MoveRequest.GetGoalActor();
+
+	//the first request only starts building the field
+	const FRPGFlowField* FlowField = FlowFields && GoalActor ? FlowFields->RequestFlowField(GoalActor) : nullptr;
+	if (!FlowField || !NavMesh)
+	{
+		return false;
+	}
+
+	//too far away for the field
+	FNavLocation StartLocation;
+	if (!NavMesh->ProjectPoint(Query.StartLocation, StartLocation, NavMesh->GetDefaultQueryExtent()) || !FlowField->FindNode(StartLocation.NodeRef))
+	{
+		return false;
+	}
+
+	FNavPathSharedPtr FlowFieldPath = NavMesh->CreatePathInstance<FNavMeshPath>(Query);
+	if (!FlowFieldPath.IsValid())
+	{
+		return false;
+	}
+
+	//a single segment to the goal, URPGPathFollowingComponent::FollowFlowField steers along the field on it
+	FlowFieldPath->GetPathPoints().Add(FNavPathPoint(StartLocation.Location, StartLocation.NodeRef));
+	FlowFieldPath->GetPathPoints().Add(FNavPathPoint(FlowField->GetTargetLocation(), FlowField->GetTargetPoly()));
+
+	//observed for the goal actor only, the field follows the goal so it never needs a repath
+	FlowFieldPath->SetGoalActorObservation(*GoalActor, WORLD_MAX);
+	FlowFieldPath->MarkReady();
 
+	OutPath = FlowFieldPath;
+	return true;
 }
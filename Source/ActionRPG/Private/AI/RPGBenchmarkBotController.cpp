@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/RPGBenchmarkBotController.h"
+#include "NavigationSystem.h"
+#include "TimerManager.h"
+#include "Engine/World.h"
+
+ARPGBenchmarkBotController::ARPGBenchmarkBotController(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	bWantsPlayerState = true;
+
+	WanderRadius = 2000.0f;
+	WanderInterval = 3.0f;
+	HomeLocation = FVector::ZeroVector;
+}
+
+void ARPGBenchmarkBotController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	HomeLocation = InPawn ? InPawn->GetActorLocation() : FVector::ZeroVector;
+
+	//stagger the bots so they don't all request a path on the same frame
+	GetWorldTimerManager().SetTimer(WanderTimerHandle, this, &ARPGBenchmarkBotController::Wander, WanderInterval, true, FMath::FRandRange(0.0f, WanderInterval));
+}
+
+void ARPGBenchmarkBotController::OnUnPossess()
+{
+	GetWorldTimerManager().ClearTimer(WanderTimerHandle);
+
+	Super::OnUnPossess();
+}
+
+void ARPGBenchmarkBotController::Wander()
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!NavSys || !GetPawn())
+	{
+		return;
+	}
+
+	FNavLocation Destination;
+	if (NavSys->GetRandomReachablePointInRadius(HomeLocation, WanderRadius, Destination))
+	{
+		MoveToLocation(Destination.Location);
+	}
+}
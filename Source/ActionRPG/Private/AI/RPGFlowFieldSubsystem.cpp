@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/RPGFlowFieldSubsystem.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("RPGFlowField: build fields"), STAT_RPGFlowField_Build, STATGROUP_AI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RPGFlowField: fields built"), STAT_RPGFlowField_NumBuilt, STATGROUP_AI);
+
+FRPGFlowField::FRPGFlowField()
+	: TargetPoly(INVALID_NAVNODEREF), TargetLocation(FVector::ZeroVector)
+{
+
+}
+
+void FRPGFlowField::Build(const ARecastNavMesh& NavMesh, const FVector& InTargetLocation, NavNodeRef InTargetPoly, float MaxDistance, int32 MaxNodes)
+{
+	Nodes.Reset();
+	OpenList.Reset();
+
+	TargetPoly = InTargetPoly;
+	TargetLocation = InTargetLocation;
+
+	if (TargetPoly == INVALID_NAVNODEREF)
+	{
+		return;
+	}
+
+	Nodes.Add(TargetPoly, { 0.0f, INVALID_NAVNODEREF, TargetLocation });
+	OpenList.HeapPush({ TargetPoly, 0.0f, TargetLocation });
+
+	//dijkstra from the target, a poly is final when it is popped with the distance stored in its node
+	while (OpenList.Num() > 0 && Nodes.Num() < MaxNodes)
+	{
+		FOpenNode Current;
+		OpenList.HeapPop(Current, false);
+
+		const FNode* CurrentNode = Nodes.Find(Current.Poly);
+		if (!CurrentNode || CurrentNode->Distance < Current.Distance)
+		{
+			//already reached with a shorter distance
+			continue;
+		}
+
+		Neighbors.Reset();
+		NavMesh.GetPolyNeighbors(Current.Poly, Neighbors);
+
+		for (const FNavigationPortalEdge& Edge : Neighbors)
+		{
+			const FVector Portal = Edge.GetMiddlePoint();
+			const float Distance = Current.Distance + FVector::Dist(Current.Location, Portal);
+			if (Distance > MaxDistance)
+			{
+				continue;
+			}
+
+			FNode* Node = Nodes.Find(Edge.ToRef);
+			if (Node && Node->Distance <= Distance)
+			{
+				continue;
+			}
+
+			//moving from the neighbor towards the target goes through this portal into the current poly
+			const FNode NewNode = { Distance, Current.Poly, Portal };
+			if (Node)
+			{
+				*Node = NewNode;
+			}
+			else
+			{
+				Nodes.Add(Edge.ToRef, NewNode);
+			}
+
+			OpenList.HeapPush({ Edge.ToRef, Distance, Portal });
+		}
+	}
+}
+
+bool FRPGFlowField::Sample(NavNodeRef Poly, FVector& OutMoveTarget) const
+{
+	const FNode* Node = Nodes.Find(Poly);
+	if (!Node)
+	{
+		return false;
+	}
+
+	OutMoveTarget = Node->NextPoly == INVALID_NAVNODEREF ? TargetLocation : Node->PortalLocation;
+	return true;
+}
+
+URPGFlowFieldSubsystem::URPGFlowFieldSubsystem()
+{
+	UpdateInterval = 0.25f;
+	UnusedTimeout = 2.0f;
+	MaxFieldDistance = 10000.0f;
+	MaxFieldNodes = 4096;
+}
+
+const FRPGFlowField* URPGFlowFieldSubsystem::RequestFlowField(const AActor* Target)
+{
+	if (!Target)
+	{
+		return nullptr;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	for (const TUniquePtr<FTargetField>& TargetField : Fields)
+	{
+		if (TargetField->Target.Get() == Target)
+		{
+			TargetField->LastRequestTime = Now;
+			return TargetField->bBuilt ? &TargetField->Field : nullptr;
+		}
+	}
+
+	FTargetField* NewField = new FTargetField();
+	NewField->Target = Target;
+	NewField->bBuilt = false;
+	NewField->LastBuildTime = -BIG_NUMBER;
+	NewField->LastRequestTime = Now;
+	NewField->PendingTargetPoly = INVALID_NAVNODEREF;
+	NewField->PendingTargetLocation = FVector::ZeroVector;
+
+	Fields.Add(TUniquePtr<FTargetField>(NewField));
+	return nullptr;
+}
+
+void URPGFlowFieldSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RPGFlowField_Build);
+
+	UWorld* World = GetWorld();
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	const ARecastNavMesh* NavMesh = NavSys ? Cast<const ARecastNavMesh>(NavSys->GetDefaultNavDataInstance()) : nullptr;
+	if (!NavMesh)
+	{
+		return;
+	}
+
+	const float Now = World->GetTimeSeconds();
+	const FVector QueryExtent = NavMesh->GetDefaultQueryExtent();
+
+	FieldsToBuild.Reset();
+	for (int32 Index = Fields.Num() - 1; Index >= 0; Index--)
+	{
+		FTargetField& TargetField = *Fields[Index];
+
+		const AActor* Target = TargetField.Target.Get();
+		if (!Target || Now - TargetField.LastRequestTime > UnusedTimeout)
+		{
+			Fields.RemoveAtSwap(Index);
+			continue;
+		}
+
+		if (Now - TargetField.LastBuildTime < UpdateInterval)
+		{
+			continue;
+		}
+
+		//find the target poly here, the workers only walk the navmesh
+		TargetField.PendingTargetLocation = Target->GetActorLocation();
+		FNavLocation TargetNavLocation;
+		if (!NavMesh->ProjectPoint(TargetField.PendingTargetLocation, TargetNavLocation, QueryExtent))
+		{
+			//off the navmesh (jumping etc.), keep the last field
+			continue;
+		}
+
+		TargetField.PendingTargetLocation = TargetNavLocation.Location;
+		TargetField.PendingTargetPoly = TargetNavLocation.NodeRef;
+		FieldsToBuild.Add(&TargetField);
+	}
+
+	if (FieldsToBuild.Num() == 0)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT_BY(STAT_RPGFlowField_NumBuilt, FieldsToBuild.Num());
+
+	//the navigation system has already ticked this frame, nothing changes the navmesh until the next one
+	const float MaxDistance = MaxFieldDistance;
+	const int32 MaxNodes = MaxFieldNodes;
+	ParallelFor(FieldsToBuild.Num(), [this, NavMesh, MaxDistance, MaxNodes](int32 Index)
+	{
+		FTargetField* TargetField = FieldsToBuild[Index];
+		TargetField->Field.Build(*NavMesh, TargetField->PendingTargetLocation, TargetField->PendingTargetPoly, MaxDistance, MaxNodes);
+	});
+
+	for (FTargetField* TargetField : FieldsToBuild)
+	{
+		TargetField->bBuilt = true;
+		TargetField->LastBuildTime = Now;
+	}
+}
+
+bool URPGFlowFieldSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return Fields.Num() > 0 && World && World->IsGameWorld() && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId URPGFlowFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URPGFlowFieldSubsystem, STATGROUP_Tickables);
+}
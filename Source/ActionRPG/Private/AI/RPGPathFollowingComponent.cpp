@@ -3,17 +3,252 @@
 
 #include "AI/RPGPathFollowingComponent.h"
 #include "AI/RPGAIController.h"
+#include "AI/RPGFlowFieldSubsystem.h"
+#include "AI/RPGRecastNavMesh.h"
+#include "AI/RPGPawnSpatialSubsystem.h"
 #include "GameFramework/Character.h"
 #include "DrawDebugHelpers.h"
 
+DECLARE_CYCLE_STAT(TEXT("RPGPathFollowing: grid avoidance"), STAT_RPGPathFollowing_Avoidance, STATGROUP_AI);
+
+namespace RPGAvoidance
+{
+	static const int32 MaxNeighbours = 16;
+
+	//neighbours relative to the agent, one array per component so the time to collision loop has no gathers
+	struct FNeighbours
+	{
+		float PositionX[MaxNeighbours];
+		float PositionY[MaxNeighbours];
+		float VelocityX[MaxNeighbours];
+		float VelocityY[MaxNeighbours];
+		float RadiusSquared[MaxNeighbours];
+		int32 Num;
+	};
+
+	//earliest time the candidate collides with any neighbour, reciprocal so both agents take half of the avoidance
+	static float TimeToCollision(const FNeighbours& Neighbours, float CandidateX, float CandidateY, float OwnX, float OwnY, float TimeHorizon)
+	{
+		float MinTime = TimeHorizon;
+
+		for (int32 Index = 0; Index < Neighbours.Num; Index++)
+		{
+			const float RelVelX = 2.0f * CandidateX - OwnX - Neighbours.VelocityX[Index];
+			const float RelVelY = 2.0f * CandidateY - OwnY - Neighbours.VelocityY[Index];
+			const float PosX = Neighbours.PositionX[Index];
+			const float PosY = Neighbours.PositionY[Index];
+
+			//|P - V t| = R
+			const float A = RelVelX * RelVelX + RelVelY * RelVelY;
+			const float B = PosX * RelVelX + PosY * RelVelY;
+			const float C = PosX * PosX + PosY * PosY - Neighbours.RadiusSquared[Index];
+			const float Discriminant = B * B - A * C;
+
+			//overlapping already counts as an immediate collision, moving apart or missing never collides
+			const float Time = C < 0.0f ? 0.0f : (B > 0.0f && Discriminant > 0.0f && A > KINDA_SMALL_NUMBER) ? (B - FMath::Sqrt(Discriminant)) / A : TimeHorizon;
+			MinTime = FMath::Min(MinTime, Time);
+		}
+
+		return MinTime;
+	}
+}
+
 URPGPathFollowingComponent::URPGPathFollowingComponent(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
-	
+	bUseFlowField = false;
+
+	RepathBackoffBaseDelay = 0.25f;
+	RepathBackoffMaxDelay = 4.0f;
+	PartialPathEndTolerance = 50.0f;
+
+	ConsecutivePathFailures = 0;
+	NextPathRequestTime = 0.0f;
+
+	AvoidanceNeighbourRadius = 400.0f;
+	MaxAvoidanceNeighbours = 8;
+	AvoidanceTimeHorizon = 1.5f;
+	AvoidanceCollisionWeight = 200.0f;
+	bUseGridAvoidance = false;
+}
+
+void URPGPathFollowingComponent::SetMovementComponent(UNavMovementComponent* MoveComp)
+{
+	Super::SetMovementComponent(MoveComp);
+
+	//the agent properties may have changed
+	CachedNavData.Reset();
+}
+
+const ARPGRecastNavMesh* URPGPathFollowingComponent::GetRPGNavMesh() const
+{
+	return Cast<ARPGRecastNavMesh>(GetNavData());
+}
+
+bool URPGPathFollowingComponent::CanRequestPath() const
+{
+	return ConsecutivePathFailures == 0 || GetWorld()->GetTimeSeconds() >= NextPathRequestTime;
+}
+
+void URPGPathFollowingComponent::RegisterPathFailure()
+{
+	ConsecutivePathFailures++;
+
+	const float Delay = FMath::Min(RepathBackoffBaseDelay * FMath::Pow(2.0f, (float)FMath::Min(ConsecutivePathFailures - 1, 16)), RepathBackoffMaxDelay);
+	NextPathRequestTime = GetWorld()->GetTimeSeconds() + Delay;
+}
+
+void URPGPathFollowingComponent::ResetPathFailures()
+{
+	ConsecutivePathFailures = 0;
+	NextPathRequestTime = 0.0f;
+}
+
+void URPGPathFollowingComponent::OnPathFinished(const FPathFollowingResult& Result)
+{
+	//read before Super, it clears the path
+	const bool bPartialPath = Path.IsValid() && Path->IsPartial();
+
+	if (Result.HasFlag(FPathFollowingResultFlags::Blocked) || Result.HasFlag(FPathFollowingResultFlags::InvalidPath) || (Result.IsSuccess() && bPartialPath))
+	{
+		RegisterPathFailure();
+	}
+	else if (Result.IsSuccess())
+	{
+		ResetPathFailures();
+	}
+
+	Super::OnPathFinished(Result);
+}
+
+void URPGPathFollowingComponent::SetGridAvoidanceEnabled(bool bEnabled)
+{
+	bUseGridAvoidance = bEnabled;
+
+	if (bEnabled)
+	{
+		PostProcessMove.BindUObject(this, &URPGPathFollowingComponent::ApplyGridAvoidance);
+	}
+	else
+	{
+		PostProcessMove.Unbind();
+	}
+}
+
+void URPGPathFollowingComponent::ApplyGridAvoidance(UPathFollowingComponent* PathFollowingComponent, FVector& Move)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RPGPathFollowing_Avoidance);
+
+	const URPGPawnSpatialSubsystem* SpatialSubsystem = GetWorld()->GetSubsystem<URPGPawnSpatialSubsystem>();
+	if (!MovementComp || !SpatialSubsystem || !SpatialSubsystem->HasUpdated())
+	{
+		return;
+	}
+
+	const float MaxSpeed = MovementComp->GetMaxSpeed();
+	if (MaxSpeed <= 0.0f)
+	{
+		return;
+	}
+
+	const bool bAccelerationInput = MovementComp->UseAccelerationForPathFollowing();
+	const FVector Preferred = bAccelerationInput ? Move * MaxSpeed : Move.GetClampedToMaxSize(MaxSpeed);
+	if (Preferred.SizeSquared2D() < KINDA_SMALL_NUMBER)
+	{
+		return;
+	}
+
+	const APawn* Pawn = Cast<APawn>(MovementComp->GetOwner());
+	const FVector Location = MovementComp->GetActorFeetLocation();
+
+	AvoidanceNeighbours.Reset();
+	SpatialSubsystem->FindAIPawnsInRadius(Location, AvoidanceNeighbourRadius, AvoidanceNeighbours, Pawn);
+	SpatialSubsystem->FindPlayerPawnsInRadius(Location, AvoidanceNeighbourRadius, AvoidanceNeighbours, Pawn);
+	if (AvoidanceNeighbours.Num() == 0)
+	{
+		return;
+	}
+
+	const int32 NumNeighbours = FMath::Min(FMath::Min(MaxAvoidanceNeighbours, RPGAvoidance::MaxNeighbours), AvoidanceNeighbours.Num());
+	if (AvoidanceNeighbours.Num() > NumNeighbours)
+	{
+		AvoidanceNeighbours.Sort([&Location](const APawn& A, const APawn& B)
+		{
+			return FVector::DistSquared2D(A.GetActorLocation(), Location) < FVector::DistSquared2D(B.GetActorLocation(), Location);
+		});
+	}
+
+	const float OwnRadius = Pawn ? Pawn->GetSimpleCollisionRadius() : MovementComp->GetNavAgentPropertiesRef().AgentRadius;
+
+	RPGAvoidance::FNeighbours Neighbours;
+	Neighbours.Num = NumNeighbours;
+	for (int32 Index = 0; Index < NumNeighbours; Index++)
+	{
+		const APawn* Neighbour = AvoidanceNeighbours[Index];
+		const FVector RelativePosition = Neighbour->GetActorLocation() - Location;
+		const FVector NeighbourVelocity = Neighbour->GetVelocity();
+
+		Neighbours.PositionX[Index] = RelativePosition.X;
+		Neighbours.PositionY[Index] = RelativePosition.Y;
+		Neighbours.VelocityX[Index] = NeighbourVelocity.X;
+		Neighbours.VelocityY[Index] = NeighbourVelocity.Y;
+		Neighbours.RadiusSquared[Index] = FMath::Square(OwnRadius + Neighbour->GetSimpleCollisionRadius());
+	}
+
+	//candidates fan out around the preferred direction at full and half speed
+	static const float SampleAngles[] = { 0.0f, 20.0f, -20.0f, 40.0f, -40.0f, 65.0f, -65.0f, 90.0f, -90.0f };
+	static const float SampleScales[] = { 1.0f, 0.5f };
+
+	const FVector2D PreferredVelocity(Preferred.X, Preferred.Y);
+	const FVector2D OwnVelocity(MovementComp->Velocity.X, MovementComp->Velocity.Y);
+
+	FVector2D BestVelocity = PreferredVelocity;
+	float BestPenalty = MAX_flt;
+
+	for (const float Angle : SampleAngles)
+	{
+		float Sin, Cos;
+		FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(Angle));
+		const FVector2D Direction(PreferredVelocity.X * Cos - PreferredVelocity.Y * Sin, PreferredVelocity.X * Sin + PreferredVelocity.Y * Cos);
+
+		for (const float Scale : SampleScales)
+		{
+			const FVector2D Candidate = Direction * Scale;
+			const float Time = RPGAvoidance::TimeToCollision(Neighbours, Candidate.X, Candidate.Y, OwnVelocity.X, OwnVelocity.Y, AvoidanceTimeHorizon);
+
+			//no collision within the horizon costs nothing
+			const float CollisionPenalty = Time < AvoidanceTimeHorizon ? AvoidanceCollisionWeight / FMath::Max(Time, 0.01f) : 0.0f;
+			const float Penalty = FVector2D::Distance(Candidate, PreferredVelocity) + CollisionPenalty;
+			if (Penalty < BestPenalty)
+			{
+				BestPenalty = Penalty;
+				BestVelocity = Candidate;
+			}
+		}
+	}
+
+	const FVector Avoided(BestVelocity.X, BestVelocity.Y, Preferred.Z);
+	Move = bAccelerationInput ? Avoided / MaxSpeed : Avoided;
 }
 
 void URPGPathFollowingComponent::FollowPathSegment(float DeltaTime)
 {
+	//the goal can't be reached from the end of a partial path, stop there instead of pushing against it until the block detection kicks in
+	if (Path.IsValid() && Path->IsPartial() && MovementComp && Path->GetPathPoints().Num() > 0)
+	{
+		const FVector PathEnd = Path->GetPathPoints().Last().Location;
+		if (FVector::DistSquared2D(MovementComp->GetActorFeetLocation(), PathEnd) < FMath::Square(PartialPathEndTolerance))
+		{
+			OnPathFinished(FPathFollowingResult(EPathFollowingResult::Blocked, FPathFollowingResultFlags::None));
+			return;
+		}
+	}
+
+	if (bUseFlowField && FollowFlowField(DeltaTime))
+	{
+		return;
+	}
+
 	Super::FollowPathSegment(DeltaTime);
 
 /*
@@ -30,13 +265,6 @@ void URPGPathFollowingComponent::FollowPathSegment(float DeltaTime)
 		}
 	}*/
 
-/*
-	if (Path->IsPartial())
-	{
-		OnPathFinished(EPathFollowingResult::Blocked, FPathFollowingResultFlags::None);
-		return;
-	}*/
-
 /*
 	//const ANavigationData* NavData = GetNavData();
 	TArray<NavNodeRef> NavPolys;
@@ -96,6 +324,60 @@ void URPGPathFollowingComponent::FollowPathSegment(float DeltaTime)
 
 }
 
+bool URPGPathFollowingComponent::FollowFlowField(float DeltaTime)
+{
+	if (!Path.IsValid() || !MovementComp || MoveSegmentStartIndex < Path->GetPathPoints().Num() - 2)
+	{
+		return false;
+	}
+
+	const AActor* GoalActor = Path->GetGoalActor();
+	URPGFlowFieldSubsystem* FlowFields = GetWorld()->GetSubsystem<URPGFlowFieldSubsystem>();
+	const FRPGFlowField* FlowField = GoalActor && FlowFields ? FlowFields->RequestFlowField(GoalActor) : nullptr;
+	const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(GetNavData());
+	if (!FlowField || !NavMesh)
+	{
+		return false;
+	}
+
+	const FVector CurrentLocation = MovementComp->GetActorFeetLocation();
+
+	FNavLocation NavLocation;
+	if (!NavMesh->ProjectPoint(CurrentLocation, NavLocation, NavMesh->GetDefaultQueryExtent()))
+	{
+		return false;
+	}
+
+	FVector MoveTarget;
+	if (!FlowField->Sample(NavLocation.NodeRef, MoveTarget))
+	{
+		return false;
+	}
+
+	//the field is a few frames old, in the goal's poly go straight for where it is now
+	if (NavLocation.NodeRef == FlowField->GetTargetPoly())
+	{
+		MoveTarget = GoalActor->GetActorLocation();
+	}
+
+	const FVector MoveDirection = (MoveTarget - CurrentLocation).GetSafeNormal2D();
+	if (MovementComp->UseAccelerationForPathFollowing())
+	{
+		FVector MoveInput = MoveDirection;
+		PostProcessMove.ExecuteIfBound(this, MoveInput);
+		MovementComp->RequestPathMove(MoveInput);
+	}
+	else
+	{
+		//portals are not stopping points, keep the max speed until the last segment logic slows us down at the goal
+		FVector MoveVelocity = MoveDirection * MovementComp->GetMaxSpeed();
+		PostProcessMove.ExecuteIfBound(this, MoveVelocity);
+		MovementComp->RequestDirectMove(MoveVelocity, true);
+	}
+
+	return true;
+}
+
 bool URPGPathFollowingComponent::GetAllPolys(TArray<NavNodeRef>& OutPolys)
 {
 	if (!MovementComp)
@@ -103,6 +385,12 @@ bool URPGPathFollowingComponent::GetAllPolys(TArray<NavNodeRef>& OutPolys)
 		return false;
 	}
 
+	if (const ARPGRecastNavMesh* RPGNavMesh = GetRPGNavMesh())
+	{
+		RPGNavMesh->GetCachedPolys(OutPolys);
+		return true;
+	}
+
 	//Get Nav Data
 	const ANavigationData* NavData = GetNavData();
 
@@ -152,14 +440,41 @@ bool URPGPathFollowingComponent::NavPoly_GetVerts(const NavNodeRef& PolyID, TArr
 
 FBox URPGPathFollowingComponent::NavPoly_GetBounds(const NavNodeRef& PolyID) const
 {
-	TArray<FVector> Verts;
-	NavPoly_GetVerts(PolyID, Verts); //#TODO check return bool 
-
 	FBox Bounds(EForceInit::ForceInitToZero);
-	for (const FVector& Each : Verts)
+
+	const ARPGRecastNavMesh* RPGNavMesh = GetRPGNavMesh();
+	if (RPGNavMesh && RPGNavMesh->GetCachedPolyBounds(PolyID, Bounds))
+	{
+		return Bounds;
+	}
+
+	PolyVertsScratch.Reset();
+	if (!NavPoly_GetVerts(PolyID, PolyVertsScratch))
+	{
+		return Bounds;
+	}
+
+	for (const FVector& Each : PolyVertsScratch)
 	{
-		Bounds += Verts;
+		Bounds += Each;
 	}
 
 	return Bounds;
 }
+
+bool URPGPathFollowingComponent::NavPoly_GetCenter(const NavNodeRef& PolyID, FVector& OutCenter) const
+{
+	if (const ARPGRecastNavMesh* RPGNavMesh = GetRPGNavMesh())
+	{
+		return RPGNavMesh->GetCachedPolyCenter(PolyID, OutCenter);
+	}
+
+	const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(GetNavData());
+	return NavMesh && NavMesh->GetPolyCenter(PolyID, OutCenter);
+}
+
+NavNodeRef URPGPathFollowingComponent::NavPoly_FindNearest(const FVector& Location, float MaxDistance, FBox& OutBounds) const
+{
+	const ARPGRecastNavMesh* RPGNavMesh = GetRPGNavMesh();
+	return RPGNavMesh ? RPGNavMesh->FindNearestCachedPoly(Location, MaxDistance, &OutBounds) : INVALID_NAVNODEREF;
+}
@@ -0,0 +1,271 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/RPGPathRequestSubsystem.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "NavMesh/NavMeshPath.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "UObject/UObjectGlobals.h"
+
+DECLARE_CYCLE_STAT(TEXT("RPGPathRequest: finish batch"), STAT_RPGPathRequest_FinishBatch, STATGROUP_AI);
+DECLARE_CYCLE_STAT(TEXT("RPGPathRequest: run batch"), STAT_RPGPathRequest_RunBatch, STATGROUP_AI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RPGPathRequest: batched requests"), STAT_RPGPathRequest_NumRequests, STATGROUP_AI);
+
+URPGPathRequestSubsystem::URPGPathRequestSubsystem()
+{
+	RequestsPerWorkItem = 4;
+	MaxRepathsPerFrame = 8;
+
+	NumRepathsThisFrame = 0;
+	RepathQuotaFrame = 0;
+}
+
+void URPGPathRequestSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WorldTickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &URPGPathRequestSubsystem::OnWorldTickStart);
+	PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &URPGPathRequestSubsystem::OnPreGarbageCollect);
+}
+
+void URPGPathRequestSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(WorldTickStartHandle);
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+
+	//the workers hold raw pointers to the nav data
+	if (BatchTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(BatchTask);
+		BatchTask = nullptr;
+	}
+
+	InFlightRequests.Empty();
+	QueuedRequests.Empty();
+	QueuedRequestIndices.Empty();
+	ObservedPaths.Empty();
+
+	Super::Deinitialize();
+}
+
+void URPGPathRequestSubsystem::RequestPath(const FPathFindingQuery& Query, FNavPathSharedPtr PendingPath, UPathFollowingComponent* PathFollowingComponent)
+{
+	if (!PendingPath.IsValid())
+	{
+		return;
+	}
+
+	FPathRequest Request;
+	Request.Query = Query;
+	//the worker fills a path of its own, the pending one is observed by the path following component on the game thread
+	Request.Query.PathInstanceToFill = nullptr;
+	Request.PendingPath = PendingPath;
+	Request.PathFollowingComponent = PathFollowingComponent;
+	Request.UpdateType = ENavPathUpdateType::NavigationChanged;
+	Request.bCancelled = false;
+
+	const int32 Index = QueuedRequests.Add(MoveTemp(Request));
+
+	if (PathFollowingComponent)
+	{
+		//retargeting several times in a frame only needs the last path
+		if (const int32* PreviousIndex = QueuedRequestIndices.Find(PathFollowingComponent))
+		{
+			QueuedRequests[*PreviousIndex].bCancelled = true;
+		}
+
+		QueuedRequestIndices.Add(PathFollowingComponent, Index);
+	}
+}
+
+void URPGPathRequestSubsystem::ObservePath(FNavPathSharedPtr Path, UPathFollowingComponent* PathFollowingComponent, float TetherDistance)
+{
+	if (!Path.IsValid() || !PathFollowingComponent)
+	{
+		return;
+	}
+
+	FObservedPath ObservedPath;
+	ObservedPath.Path = Path;
+	ObservedPath.PathFollowingComponent = PathFollowingComponent;
+	ObservedPath.TetherDistanceSq = FMath::Square(TetherDistance);
+
+	ObservedPaths.Add(ObservedPath);
+}
+
+bool URPGPathRequestSubsystem::ConsumeRepathQuota()
+{
+	if (RepathQuotaFrame != GFrameCounter)
+	{
+		RepathQuotaFrame = GFrameCounter;
+		NumRepathsThisFrame = 0;
+	}
+
+	if (NumRepathsThisFrame >= MaxRepathsPerFrame)
+	{
+		return false;
+	}
+
+	NumRepathsThisFrame++;
+	return true;
+}
+
+void URPGPathRequestSubsystem::Tick(float DeltaTime)
+{
+	//the previous batch is normally finished at the start of the world tick, this only happens if the world didn't tick
+	FinishBatch();
+
+	TickObservedPaths();
+
+	InFlightRequests.Reset();
+	for (FPathRequest& Request : QueuedRequests)
+	{
+		if (!Request.bCancelled)
+		{
+			InFlightRequests.Add(MoveTemp(Request));
+		}
+	}
+
+	QueuedRequests.Reset();
+	QueuedRequestIndices.Reset();
+
+	if (InFlightRequests.Num() == 0)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT_BY(STAT_RPGPathRequest_NumRequests, InFlightRequests.Num());
+
+	TArray<FPathRequest>* Requests = &InFlightRequests;
+	const int32 NumWorkItems = FMath::DivideAndRoundUp(InFlightRequests.Num(), FMath::Max(RequestsPerWorkItem, 1));
+	const int32 NumRequests = InFlightRequests.Num();
+
+	BatchTask = FFunctionGraphTask::CreateAndDispatchWhenReady([Requests, NumWorkItems, NumRequests]()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RPGPathRequest_RunBatch);
+
+		ParallelFor(NumWorkItems, [Requests, NumWorkItems, NumRequests](int32 WorkItem)
+		{
+			const int32 Start = (int32)((int64)NumRequests * WorkItem / NumWorkItems);
+			const int32 End = (int32)((int64)NumRequests * (WorkItem + 1) / NumWorkItems);
+
+			for (int32 Index = Start; Index < End; Index++)
+			{
+				FPathRequest& Request = (*Requests)[Index];
+
+				//ARPGRecastNavMesh::FindPath is safe to run on several threads at once
+				const ANavigationData* NavData = Request.Query.NavData.Get();
+				Request.Result = NavData ? NavData->FindPath(Request.Query.NavAgentProperties, Request.Query) : FPathFindingResult(ENavigationQueryResult::Error);
+			}
+		});
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+void URPGPathRequestSubsystem::FinishBatch()
+{
+	if (!BatchTask.IsValid())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_RPGPathRequest_FinishBatch);
+
+	FTaskGraphInterface::Get().WaitUntilTaskCompletes(BatchTask);
+	BatchTask = nullptr;
+
+	for (FPathRequest& Request : InFlightRequests)
+	{
+		FNavigationPath* PendingPath = Request.PendingPath.Get();
+		const FNavMeshPath* ResultPath = Request.Result.IsSuccessful() && Request.Result.Path.IsValid() ? Request.Result.Path->CastPath<FNavMeshPath>() : nullptr;
+
+		UPathFollowingComponent* PathFollowingComponent = Request.PathFollowingComponent.Get();
+		const bool bStillWaiting = PathFollowingComponent && PathFollowingComponent->GetPath() == Request.PendingPath;
+
+		if (!ResultPath)
+		{
+			if (bStillWaiting)
+			{
+				PathFollowingComponent->AbortMove(*this, FPathFollowingResultFlags::InvalidPath);
+			}
+			continue;
+		}
+
+		PendingPath->GetPathPoints() = ResultPath->GetPathPoints();
+		PendingPath->SetIsPartial(ResultPath->IsPartial());
+		PendingPath->SetSearchReachedLimit(ResultPath->DidSearchReachedLimit());
+
+		if (FNavMeshPath* PendingNavMeshPath = PendingPath->CastPath<FNavMeshPath>())
+		{
+			PendingNavMeshPath->PathCorridor = ResultPath->PathCorridor;
+			PendingNavMeshPath->PathCorridorCost = ResultPath->PathCorridorCost;
+			PendingNavMeshPath->bStringPulled = ResultPath->bStringPulled;
+		}
+
+		PendingPath->MarkReady();
+
+		//the path following component starts moving when a path it is waiting on is updated, and restarts from the new points on a repath
+		PendingPath->DoneUpdating(Request.UpdateType);
+	}
+
+	InFlightRequests.Reset();
+}
+
+void URPGPathRequestSubsystem::TickObservedPaths()
+{
+	for (int32 Index = ObservedPaths.Num() - 1; Index >= 0; Index--)
+	{
+		const FObservedPath& ObservedPath = ObservedPaths[Index];
+
+		FNavPathSharedPtr Path = ObservedPath.Path.Pin();
+		UPathFollowingComponent* PathFollowingComponent = ObservedPath.PathFollowingComponent.Get();
+		if (!Path.IsValid() || !PathFollowingComponent || PathFollowingComponent->GetPath() != Path || !Path->GetGoalActor())
+		{
+			ObservedPaths.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		//still waiting on its first batch
+		if (!Path->IsReady())
+		{
+			continue;
+		}
+
+		if (FVector::DistSquared(Path->GetGoalLocation(), Path->GetLastRepathGoalLocation()) <= ObservedPath.TetherDistanceSq)
+		{
+			continue;
+		}
+
+		//the goal location is moved now so the path isn't requested again every frame until the batch is done
+		Path->UpdateLastRepathGoalLocation();
+
+		//same query the navigation data would make, from the querier's current location to the goal actor
+		RequestPath(FPathFindingQuery(Path.ToSharedRef()), Path, PathFollowingComponent);
+		QueuedRequests.Last().UpdateType = ENavPathUpdateType::GoalMoved;
+	}
+}
+
+void URPGPathRequestSubsystem::OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	//before the navigation system ticks and can rebuild tiles the workers are reading
+	if (InWorld == GetWorld())
+	{
+		FinishBatch();
+	}
+}
+
+void URPGPathRequestSubsystem::OnPreGarbageCollect()
+{
+	FinishBatch();
+}
+
+bool URPGPathRequestSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return (QueuedRequests.Num() > 0 || BatchTask.IsValid() || ObservedPaths.Num() > 0) && World && World->IsGameWorld() && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId URPGPathRequestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URPGPathRequestSubsystem, STATGROUP_Tickables);
+}
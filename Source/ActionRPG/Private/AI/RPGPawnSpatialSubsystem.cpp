@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/RPGPawnSpatialSubsystem.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("RPGPawnSpatial: update grids"), STAT_RPGPawnSpatial_Update, STATGROUP_AI);
+
+//below this many entries a straight scan over the contiguous entries is cheaper than walking the cells
+static const int32 SpatialGridLinearScanThreshold = 16;
+
+FRPGPawnSpatialGrid::FRPGPawnSpatialGrid()
+	: CellSize(1000.0f), InvCellSize(1.0f / 1000.0f), MinCell(0, 0), MaxCell(0, 0)
+{
+
+}
+
+void FRPGPawnSpatialGrid::Reset(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.0f);
+	InvCellSize = 1.0f / CellSize;
+
+	//keep the memory, this is rebuilt every frame
+	Entries.Reset();
+	Cells.Reset();
+
+	MinCell = FIntPoint(MAX_int32, MAX_int32);
+	MaxCell = FIntPoint(MIN_int32, MIN_int32);
+}
+
+void FRPGPawnSpatialGrid::Add(APawn* Pawn, const FVector& Location)
+{
+	const FIntPoint Cell = GetCell(Location);
+
+	MinCell = FIntPoint(FMath::Min(MinCell.X, Cell.X), FMath::Min(MinCell.Y, Cell.Y));
+	MaxCell = FIntPoint(FMath::Max(MaxCell.X, Cell.X), FMath::Max(MaxCell.Y, Cell.Y));
+
+	Entries.Add({ Pawn, Location, MakeCellKey(Cell.X, Cell.Y) });
+}
+
+void FRPGPawnSpatialGrid::Finalize()
+{
+	Entries.Sort([](const FEntry& A, const FEntry& B) { return A.CellKey < B.CellKey; });
+
+	for (int32 Index = 0; Index < Entries.Num(); Index++)
+	{
+		FCell& Cell = Cells.FindOrAdd(Entries[Index].CellKey);
+		if (Cell.Num == 0)
+		{
+			Cell.Start = Index;
+		}
+
+		Cell.Num++;
+	}
+}
+
+APawn* FRPGPawnSpatialGrid::FindNearest(const FVector& Origin, float MaxDistance, const APawn* Ignore, float& OutDistanceSquared) const
+{
+	APawn* BestPawn = nullptr;
+	float BestDistanceSquared = FMath::Square(MaxDistance);
+
+	auto TestEntry = [&](const FEntry& Entry)
+	{
+		if (Entry.Pawn == Ignore)
+		{
+			return;
+		}
+
+		const float DistanceSquared = FVector::DistSquared(Origin, Entry.Location);
+		if (DistanceSquared < BestDistanceSquared)
+		{
+			BestDistanceSquared = DistanceSquared;
+			BestPawn = Entry.Pawn;
+		}
+	};
+
+	auto TestCell = [&](int32 X, int32 Y)
+	{
+		if (const FCell* Cell = FindCell(X, Y))
+		{
+			for (int32 Index = Cell->Start; Index < Cell->Start + Cell->Num; Index++)
+			{
+				TestEntry(Entries[Index]);
+			}
+		}
+	};
+
+	if (Entries.Num() <= SpatialGridLinearScanThreshold)
+	{
+		for (const FEntry& Entry : Entries)
+		{
+			TestEntry(Entry);
+		}
+	}
+	else
+	{
+		//search outwards ring by ring, a cell in ring R is at least (R - 1) * CellSize away from the origin
+		const FIntPoint Center = GetCell(Origin);
+		const int32 MaxRing = FMath::Max(FMath::Max(FMath::Abs(Center.X - MinCell.X), FMath::Abs(Center.X - MaxCell.X)),
+			FMath::Max(FMath::Abs(Center.Y - MinCell.Y), FMath::Abs(Center.Y - MaxCell.Y)));
+
+		for (int32 Ring = 0; Ring <= MaxRing; Ring++)
+		{
+			const float RingMinDistance = FMath::Max(Ring - 1, 0) * CellSize;
+			if (FMath::Square(RingMinDistance) > BestDistanceSquared)
+			{
+				break;
+			}
+
+			if (Ring == 0)
+			{
+				TestCell(Center.X, Center.Y);
+				continue;
+			}
+
+			//top and bottom rows of the ring, clamped to the grid extents
+			const int32 MinX = FMath::Max(Center.X - Ring, MinCell.X);
+			const int32 MaxX = FMath::Min(Center.X + Ring, MaxCell.X);
+			for (int32 X = MinX; X <= MaxX; X++)
+			{
+				TestCell(X, Center.Y - Ring);
+				TestCell(X, Center.Y + Ring);
+			}
+
+			//left and right columns, excluding the corners
+			const int32 MinY = FMath::Max(Center.Y - Ring + 1, MinCell.Y);
+			const int32 MaxY = FMath::Min(Center.Y + Ring - 1, MaxCell.Y);
+			for (int32 Y = MinY; Y <= MaxY; Y++)
+			{
+				TestCell(Center.X - Ring, Y);
+				TestCell(Center.X + Ring, Y);
+			}
+		}
+	}
+
+	OutDistanceSquared = BestPawn ? BestDistanceSquared : -1.0f;
+	return BestPawn;
+}
+
+int32 FRPGPawnSpatialGrid::FindWithinRadius(const FVector& Origin, float Radius, const APawn* Ignore, TArray<APawn*>& OutPawns) const
+{
+	const float RadiusSquared = FMath::Square(Radius);
+	const int32 StartNum = OutPawns.Num();
+
+	auto TestEntry = [&](const FEntry& Entry)
+	{
+		if (Entry.Pawn != Ignore && FVector::DistSquared(Origin, Entry.Location) <= RadiusSquared)
+		{
+			OutPawns.Add(Entry.Pawn);
+		}
+	};
+
+	const FIntPoint MinQueryCell = GetCell(Origin - FVector(Radius));
+	const FIntPoint MaxQueryCell = GetCell(Origin + FVector(Radius));
+
+	const int32 MinX = FMath::Max(MinQueryCell.X, MinCell.X);
+	const int32 MaxX = FMath::Min(MaxQueryCell.X, MaxCell.X);
+	const int32 MinY = FMath::Max(MinQueryCell.Y, MinCell.Y);
+	const int32 MaxY = FMath::Min(MaxQueryCell.Y, MaxCell.Y);
+
+	const int64 NumQueryCells = (int64)FMath::Max(MaxX - MinX + 1, 0) * (int64)FMath::Max(MaxY - MinY + 1, 0);
+
+	//a huge radius would visit more empty cells than there are entries
+	if (Entries.Num() <= SpatialGridLinearScanThreshold || NumQueryCells > Entries.Num())
+	{
+		for (const FEntry& Entry : Entries)
+		{
+			TestEntry(Entry);
+		}
+	}
+	else
+	{
+		for (int32 X = MinX; X <= MaxX; X++)
+		{
+			for (int32 Y = MinY; Y <= MaxY; Y++)
+			{
+				if (const FCell* Cell = FindCell(X, Y))
+				{
+					for (int32 Index = Cell->Start; Index < Cell->Start + Cell->Num; Index++)
+					{
+						TestEntry(Entries[Index]);
+					}
+				}
+			}
+		}
+	}
+
+	return OutPawns.Num() - StartNum;
+}
+
+URPGPawnSpatialSubsystem::URPGPawnSpatialSubsystem()
+{
+	CellSize = 1000.0f;
+	LastUpdateFrame = 0;
+}
+
+void URPGPawnSpatialSubsystem::RegisterPawn(APawn* Pawn)
+{
+	if (Pawn)
+	{
+		RegisteredPawns.AddUnique(Pawn);
+	}
+}
+
+void URPGPawnSpatialSubsystem::UnregisterPawn(APawn* Pawn)
+{
+	RegisteredPawns.RemoveSwap(Pawn);
+}
+
+APawn* URPGPawnSpatialSubsystem::FindNearestPlayerPawn(const FVector& Origin, float& OutDistanceSquared, const APawn* Ignore /*= nullptr*/, float MaxDistance /*= BIG_NUMBER*/) const
+{
+	return PlayerGrid.FindNearest(Origin, MaxDistance, Ignore, OutDistanceSquared);
+}
+
+APawn* URPGPawnSpatialSubsystem::FindNearestAIPawn(const FVector& Origin, float& OutDistanceSquared, const APawn* Ignore /*= nullptr*/, float MaxDistance /*= BIG_NUMBER*/) const
+{
+	return AIGrid.FindNearest(Origin, MaxDistance, Ignore, OutDistanceSquared);
+}
+
+int32 URPGPawnSpatialSubsystem::FindPlayerPawnsInRadius(const FVector& Origin, float Radius, TArray<APawn*>& OutPawns, const APawn* Ignore /*= nullptr*/) const
+{
+	return PlayerGrid.FindWithinRadius(Origin, Radius, Ignore, OutPawns);
+}
+
+int32 URPGPawnSpatialSubsystem::FindAIPawnsInRadius(const FVector& Origin, float Radius, TArray<APawn*>& OutPawns, const APawn* Ignore /*= nullptr*/) const
+{
+	return AIGrid.FindWithinRadius(Origin, Radius, Ignore, OutPawns);
+}
+
+void URPGPawnSpatialSubsystem::Tick(float DeltaTime)
+{
+	UpdateGrids();
+}
+
+bool URPGPawnSpatialSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->IsGameWorld() && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId URPGPawnSpatialSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URPGPawnSpatialSubsystem, STATGROUP_Tickables);
+}
+
+void URPGPawnSpatialSubsystem::UpdateGrids()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RPGPawnSpatial_Update);
+
+	PlayerGrid.Reset(CellSize);
+	AIGrid.Reset(CellSize);
+
+	for (int32 Index = RegisteredPawns.Num() - 1; Index >= 0; Index--)
+	{
+		APawn* Pawn = RegisteredPawns[Index].Get();
+		if (!Pawn || Pawn->IsPendingKill())
+		{
+			RegisteredPawns.RemoveAtSwap(Index);
+			continue;
+		}
+
+		//same rules as the old player array walk, spectators are never targets
+		const APlayerState* PlayerState = Pawn->GetPlayerState();
+		if (PlayerState)
+		{
+			if (!PlayerState->IsSpectator() && !PlayerState->IsOnlyASpectator())
+			{
+				PlayerGrid.Add(Pawn, Pawn->GetActorLocation());
+			}
+		}
+		else if (Pawn->GetController())
+		{
+			AIGrid.Add(Pawn, Pawn->GetActorLocation());
+		}
+	}
+
+	PlayerGrid.Finalize();
+	AIGrid.Finalize();
+
+	LastUpdateFrame = GFrameCounter;
+}
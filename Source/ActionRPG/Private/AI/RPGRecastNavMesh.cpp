@@ -2,17 +2,52 @@
 
 
 #include "AI/RPGRecastNavMesh.h"
+#include "NavMesh/RecastQueryFilter.h"
+
+#if WITH_RECAST
+#include "Detour/DetourNavMesh.h"
+#include "Detour/DetourNavMeshQuery.h"
+#endif // WITH_RECAST
 
 /**
  * use DECLARE_CYCLE_STAT in cpp if you want to use it in a single file, otherwise include the below line with DECLARE_CYCLE_STAT_EXTERN instead of DECLARE_CYCLE_STAT
  * and in one .cpp file, use DEFINE_STAT(STAT_Navigation_CustomPathfinding);
  */
 DECLARE_CYCLE_STAT(TEXT("RPGRecast: custom pathfinding"), STAT_Navigation_CustomPathfinding, STATGROUP_Navigation)
+DECLARE_DWORD_COUNTER_STAT(TEXT("RPGRecast: path cache hits"), STAT_Navigation_CustomPathfinding_CacheHits, STATGROUP_Navigation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RPGRecast: path cache misses"), STAT_Navigation_CustomPathfinding_CacheMisses, STATGROUP_Navigation);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("RPGRecast: path cache hit rate"), STAT_Navigation_CustomPathfinding_CacheHitRate, STATGROUP_Navigation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RPGRecast: search nodes"), STAT_Navigation_CustomPathfinding_SearchNodes, STATGROUP_Navigation);
+
+#if WITH_RECAST
+namespace RPGRecastNavMesh
+{
+	//same as the engine's Unreal2RecastPoint / Recast2UnrealPoint, recast is y up
+	FORCEINLINE FVector ToRecast(const FVector& UnrealPoint)
+	{
+		return FVector(-UnrealPoint.X, UnrealPoint.Z, -UnrealPoint.Y);
+	}
+
+	FORCEINLINE FVector ToUnreal(const float* RecastPoint)
+	{
+		return FVector(-RecastPoint[0], -RecastPoint[2], RecastPoint[1]);
+	}
+}
+#endif // WITH_RECAST
 
 ARPGRecastNavMesh::ARPGRecastNavMesh(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	FindPathImplementation = FindPath;
+
+	MaxCachedPaths = 256;
+	bUsePathCache = true;
+
+	PathCacheDetourMesh = nullptr;
+	PathCacheUseCounter = 0;
+
+	bPolyCacheBuilt = false;
+	PolyCacheDetourMesh = nullptr;
 }
 
 FPathFindingResult ARPGRecastNavMesh::FindPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query)
@@ -21,10 +56,10 @@ FPathFindingResult ARPGRecastNavMesh::FindPath(const FNavAgentProperties& AgentP
 	CSV_SCOPED_TIMING_STAT_EXCLUSIVE(Pathfinding);
 
 	const ANavigationData* Self = Query.NavData.Get();
-	check(Cast<const ARecastNavMesh>(Self));
+	check(Cast<const ARPGRecastNavMesh>(Self));
 
-	const ARecastNavMesh* RecastNavMesh = (const ARecastNavMesh*)Self;
-	if (Self == NULL /*|| RecastNavMesh->RecastNavMeshImpl == NULL*/)
+	const ARPGRecastNavMesh* RecastNavMesh = (const ARPGRecastNavMesh*)Self;
+	if (Self == NULL)
 	{
 		return ENavigationQueryResult::Error;
 	}
@@ -58,18 +93,491 @@ FPathFindingResult ARPGRecastNavMesh::FindPath(const FNavAgentProperties& AgentP
 			Result.Path->GetPathPoints().Add(FNavPathPoint(AdjustedEndLocation));
 			Result.Result = ENavigationQueryResult::Success;
 		}
-/*
+#if WITH_RECAST
 		else
 		{
-			Result.Result = RecastNavMesh->RecastNavMeshImpl->FindPath(Query.StartLocation, AdjustedEndLocation, Query.CostLimit, *NavMeshPath, *NavFilter, Query.Owner.Get());
+			const dtNavMesh* DetourMesh = RecastNavMesh->GetRecastMesh();
+			const FRecastQueryFilter* RecastFilter = static_cast<const FRecastQueryFilter*>(NavFilter->GetImplementation());
+			if (!DetourMesh || !RecastFilter)
+			{
+				return Result;
+			}
 
-			const bool bPartialPath = Result.IsPartial();
-			if (bPartialPath)
+			const FVector QueryExtent = RecastNavMesh->GetDefaultQueryExtent();
+			const NavNodeRef StartPoly = RecastNavMesh->FindNearestPoly(Query.StartLocation, QueryExtent, Query.QueryFilter, Query.Owner.Get());
+			const NavNodeRef EndPoly = RecastNavMesh->FindNearestPoly(AdjustedEndLocation, QueryExtent, Query.QueryFilter, Query.Owner.Get());
+			if (StartPoly == INVALID_NAVNODEREF || EndPoly == INVALID_NAVNODEREF)
 			{
-				Result.Result = Query.bAllowPartialPaths ? ENavigationQueryResult::Success : ENavigationQueryResult::Fail;
+				Result.Result = ENavigationQueryResult::Fail;
+				return Result;
+			}
+
+			dtNavMeshQuery* NavQuery = RecastNavMesh->AcquireNavQuery(DetourMesh, NavFilter->GetMaxSearchNodes());
+			if (!NavQuery)
+			{
+				return Result;
+			}
+
+			//the start and end on their polys, string pulling and the search heuristic both use these
+			FVector RecastStart = RPGRecastNavMesh::ToRecast(Query.StartLocation);
+			FVector RecastEnd = RPGRecastNavMesh::ToRecast(AdjustedEndLocation);
+			NavQuery->closestPointOnPoly(StartPoly, &RecastStart.X, &RecastStart.X);
+			NavQuery->closestPointOnPoly(EndPoly, &RecastEnd.X, &RecastEnd.X);
+
+			//a cost limit makes the result depend on more than the polys, don't share those
+			const bool bCanUseCache = RecastNavMesh->bUsePathCache && Query.CostLimit == FLT_MAX;
+			const FPathCacheKey CacheKey = { StartPoly, EndPoly, RecastFilter };
+
+			FPathCacheEntry Corridor;
+			bool bFoundCorridor = bCanUseCache && RecastNavMesh->FindCachedCorridor(CacheKey, DetourMesh, Corridor);
+			if (bFoundCorridor)
+			{
+				INC_DWORD_STAT(STAT_Navigation_CustomPathfinding_CacheHits);
+				RecastNavMesh->PathCacheHits.Increment();
+			}
+			else
+			{
+				dtQueryResult PathResult;
+				const dtStatus Status = NavQuery->findPath(StartPoly, EndPoly, &RecastStart.X, &RecastEnd.X, Query.CostLimit, RecastFilter->GetAsDetourQueryFilter(), PathResult, nullptr);
+
+				INC_DWORD_STAT_BY(STAT_Navigation_CustomPathfinding_SearchNodes, NavQuery->getNodePool()->getNodeCount());
+
+				if (dtStatusSucceed(Status) && PathResult.size() > 0)
+				{
+					Corridor.Corridor.SetNumUninitialized(PathResult.size());
+					Corridor.CorridorCost.SetNumUninitialized(PathResult.size());
+					for (int32 Index = 0; Index < PathResult.size(); Index++)
+					{
+						Corridor.Corridor[Index] = PathResult.getRef(Index);
+						Corridor.CorridorCost[Index] = PathResult.getCost(Index);
+					}
+
+					Corridor.bPartial = dtStatusDetail(Status, DT_PARTIAL_RESULT) || Corridor.Corridor.Last() != EndPoly;
+					Corridor.bReachedSearchLimit = dtStatusDetail(Status, DT_OUT_OF_NODES);
+					bFoundCorridor = true;
+
+					if (bCanUseCache)
+					{
+						INC_DWORD_STAT(STAT_Navigation_CustomPathfinding_CacheMisses);
+						RecastNavMesh->PathCacheMisses.Increment();
+						RecastNavMesh->AddCachedCorridor(CacheKey, DetourMesh, Corridor);
+					}
+				}
 			}
-		}*/
+
+			SET_FLOAT_STAT(STAT_Navigation_CustomPathfinding_CacheHitRate, RecastNavMesh->GetPathCacheHitRate());
+
+			if (bFoundCorridor)
+			{
+				NavMeshPath->PathCorridor = Corridor.Corridor;
+				NavMeshPath->PathCorridorCost = Corridor.CorridorCost;
+				NavMeshPath->SetIsPartial(Corridor.bPartial);
+				NavMeshPath->SetSearchReachedLimit(Corridor.bReachedSearchLimit);
+
+				//partial corridors end somewhere else, pull towards the closest point on the last poly instead
+				if (Corridor.bPartial)
+				{
+					NavQuery->closestPointOnPoly(Corridor.Corridor.Last(), &RecastEnd.X, &RecastEnd.X);
+				}
+
+				TArray<FNavPathPoint>& PathPoints = NavMeshPath->GetPathPoints();
+				PathPoints.Reset();
+
+				dtQueryResult StraightResult;
+				const dtStatus StraightStatus = NavQuery->findStraightPath(&RecastStart.X, &RecastEnd.X, Corridor.Corridor.GetData(), Corridor.Corridor.Num(), StraightResult, DT_STRAIGHTPATH_AREA_CROSSINGS);
+				if (dtStatusSucceed(StraightStatus))
+				{
+					PathPoints.Reserve(StraightResult.size());
+					for (int32 Index = 0; Index < StraightResult.size(); Index++)
+					{
+						const NavNodeRef PointPoly = StraightResult.getRef(Index);
+
+						FNavMeshNodeFlags PointFlags(0);
+						PointFlags.PathFlags = StraightResult.getFlag(Index);
+						DetourMesh->getPolyArea(PointPoly, &PointFlags.Area);
+						DetourMesh->getPolyFlags(PointPoly, &PointFlags.AreaFlags);
+
+						PathPoints.Add(FNavPathPoint(RPGRecastNavMesh::ToUnreal(StraightResult.getPos(Index)), PointPoly, PointFlags.Pack()));
+					}
+
+					NavMeshPath->bStringPulled = true;
+					NavMeshPath->MarkReady();
+
+					Result.Result = ENavigationQueryResult::Success;
+					if (Corridor.bPartial && !Query.bAllowPartialPaths)
+					{
+						Result.Result = ENavigationQueryResult::Fail;
+					}
+				}
+			}
+			else
+			{
+				Result.Result = ENavigationQueryResult::Fail;
+			}
+
+			RecastNavMesh->ReleaseNavQuery(NavQuery);
+		}
+#endif // WITH_RECAST
 	}
 
 	return Result;
 }
+
+void ARPGRecastNavMesh::OnNavMeshTilesUpdated(const TArray<uint32>& ChangedTiles)
+{
+	Super::OnNavMeshTilesUpdated(ChangedTiles);
+
+	//tiles that were never built are built with the rest on first use
+	if (bPolyCacheBuilt)
+	{
+		for (const uint32 TileIndex : ChangedTiles)
+		{
+			BuildTilePolys(TileIndex);
+		}
+	}
+
+#if WITH_RECAST
+	const dtNavMesh* DetourMesh = GetRecastMesh();
+
+	FScopeLock Lock(&PathCacheLock);
+
+	if (!DetourMesh || DetourMesh != PathCacheDetourMesh)
+	{
+		PathCache.Reset();
+		PathCacheDetourMesh = DetourMesh;
+		return;
+	}
+
+	//drop every corridor that crosses a rebuilt tile
+	for (auto It = PathCache.CreateIterator(); It; ++It)
+	{
+		for (const NavNodeRef PolyRef : It.Value().Corridor)
+		{
+			if (ChangedTiles.Contains(DetourMesh->decodePolyIdTile(PolyRef)))
+			{
+				It.RemoveCurrent();
+				break;
+			}
+		}
+	}
+#endif // WITH_RECAST
+}
+
+void ARPGRecastNavMesh::BeginDestroy()
+{
+	{
+		FScopeLock Lock(&PathCacheLock);
+
+		PathCache.Empty();
+
+#if WITH_RECAST
+		for (dtNavMeshQuery* NavQuery : FreeNavQueries)
+		{
+			delete NavQuery;
+		}
+#endif // WITH_RECAST
+		FreeNavQueries.Empty();
+	}
+
+	CachedTilePolys.Empty();
+	bPolyCacheBuilt = false;
+
+	Super::BeginDestroy();
+}
+
+void ARPGRecastNavMesh::FlushPathCache()
+{
+	FScopeLock Lock(&PathCacheLock);
+	PathCache.Reset();
+}
+
+float ARPGRecastNavMesh::GetPathCacheHitRate() const
+{
+	const int32 Hits = PathCacheHits.GetValue();
+	const int32 Total = Hits + PathCacheMisses.GetValue();
+	return Total > 0 ? (float)Hits / (float)Total : 0.0f;
+}
+
+void FRPGNavTilePolys::Reset()
+{
+	PolyRefs.Reset();
+	Bounds.Reset();
+	Centers.Reset();
+	PolyIndexToSlot.Reset();
+	TileBounds = FBox(ForceInit);
+}
+
+const TArray<FRPGNavTilePolys>& ARPGRecastNavMesh::GetCachedTilePolys() const
+{
+	check(IsInGameThread());
+
+#if WITH_RECAST
+	if (bPolyCacheBuilt && PolyCacheDetourMesh != GetRecastMesh())
+	{
+		bPolyCacheBuilt = false;
+	}
+#endif // WITH_RECAST
+
+	if (!bPolyCacheBuilt)
+	{
+		BuildPolyCache();
+	}
+
+	return CachedTilePolys;
+}
+
+int32 ARPGRecastNavMesh::GetCachedPolys(TArray<NavNodeRef>& OutPolys) const
+{
+	const int32 StartNum = OutPolys.Num();
+
+	for (const FRPGNavTilePolys& TilePolys : GetCachedTilePolys())
+	{
+		OutPolys.Append(TilePolys.PolyRefs);
+	}
+
+	return OutPolys.Num() - StartNum;
+}
+
+bool ARPGRecastNavMesh::GetCachedPolyBounds(NavNodeRef PolyRef, FBox& OutBounds) const
+{
+	int32 Slot = INDEX_NONE;
+	if (const FRPGNavTilePolys* TilePolys = FindCachedTilePolys(PolyRef, Slot))
+	{
+		OutBounds = TilePolys->Bounds[Slot];
+		return true;
+	}
+
+	return false;
+}
+
+bool ARPGRecastNavMesh::GetCachedPolyCenter(NavNodeRef PolyRef, FVector& OutCenter) const
+{
+	int32 Slot = INDEX_NONE;
+	if (const FRPGNavTilePolys* TilePolys = FindCachedTilePolys(PolyRef, Slot))
+	{
+		OutCenter = TilePolys->Centers[Slot];
+		return true;
+	}
+
+	return false;
+}
+
+NavNodeRef ARPGRecastNavMesh::FindNearestCachedPoly(const FVector& Location, float MaxDistance, FBox* OutBounds /*= nullptr*/) const
+{
+	NavNodeRef NearestPoly = INVALID_NAVNODEREF;
+	float NearestDistanceSquared = FMath::Square(MaxDistance);
+
+	const TArray<FRPGNavTilePolys>& TilesPolys = GetCachedTilePolys();
+	for (const FRPGNavTilePolys& TilePolys : TilesPolys)
+	{
+		if (TilePolys.Num() == 0 || TilePolys.TileBounds.ComputeSquaredDistanceToPoint(Location) > NearestDistanceSquared)
+		{
+			continue;
+		}
+
+		for (int32 Slot = 0; Slot < TilePolys.Num(); Slot++)
+		{
+			const float DistanceSquared = TilePolys.Bounds[Slot].ComputeSquaredDistanceToPoint(Location);
+			if (DistanceSquared <= NearestDistanceSquared)
+			{
+				NearestDistanceSquared = DistanceSquared;
+				NearestPoly = TilePolys.PolyRefs[Slot];
+
+				if (OutBounds)
+				{
+					*OutBounds = TilePolys.Bounds[Slot];
+				}
+			}
+		}
+	}
+
+	return NearestPoly;
+}
+
+void ARPGRecastNavMesh::BuildPolyCache() const
+{
+	CachedTilePolys.SetNum(GetNavMeshTilesCount());
+	for (int32 TileIndex = 0; TileIndex < CachedTilePolys.Num(); TileIndex++)
+	{
+		BuildTilePolys(TileIndex);
+	}
+
+#if WITH_RECAST
+	PolyCacheDetourMesh = GetRecastMesh();
+#endif // WITH_RECAST
+	bPolyCacheBuilt = true;
+}
+
+void ARPGRecastNavMesh::BuildTilePolys(int32 TileIndex) const
+{
+	if (TileIndex >= CachedTilePolys.Num())
+	{
+		CachedTilePolys.SetNum(TileIndex + 1);
+	}
+
+	FRPGNavTilePolys& TilePolys = CachedTilePolys[TileIndex];
+	TilePolys.Reset();
+
+	//unused tile slots have invalid bounds
+	if (!GetNavMeshTileBounds(TileIndex).IsValid)
+	{
+		return;
+	}
+
+	TilePolysScratch.Reset();
+	GetPolysInTile(TileIndex, TilePolysScratch);
+
+	TilePolys.PolyRefs.Reserve(TilePolysScratch.Num());
+	TilePolys.Bounds.Reserve(TilePolysScratch.Num());
+	TilePolys.Centers.Reserve(TilePolysScratch.Num());
+
+	for (const FNavPoly& NavPoly : TilePolysScratch)
+	{
+		uint32 PolyIndex = 0;
+		uint32 PolyTileIndex = 0;
+		if (!GetPolyTileIndex(NavPoly.Ref, PolyIndex, PolyTileIndex))
+		{
+			continue;
+		}
+
+		PolyVertsScratch.Reset();
+		GetPolyVerts(NavPoly.Ref, PolyVertsScratch);
+
+		const FBox PolyBounds(PolyVertsScratch);
+
+		while ((int32)PolyIndex >= TilePolys.PolyIndexToSlot.Num())
+		{
+			TilePolys.PolyIndexToSlot.Add(INDEX_NONE);
+		}
+		TilePolys.PolyIndexToSlot[PolyIndex] = TilePolys.PolyRefs.Num();
+
+		TilePolys.PolyRefs.Add(NavPoly.Ref);
+		TilePolys.Bounds.Add(PolyBounds);
+		TilePolys.Centers.Add(NavPoly.Center);
+		TilePolys.TileBounds += PolyBounds;
+	}
+}
+
+const FRPGNavTilePolys* ARPGRecastNavMesh::FindCachedTilePolys(NavNodeRef PolyRef, int32& OutSlot) const
+{
+	uint32 PolyIndex = 0;
+	uint32 TileIndex = 0;
+	if (!GetPolyTileIndex(PolyRef, PolyIndex, TileIndex))
+	{
+		return nullptr;
+	}
+
+	const TArray<FRPGNavTilePolys>& TilesPolys = GetCachedTilePolys();
+	if (!TilesPolys.IsValidIndex(TileIndex) || !TilesPolys[TileIndex].PolyIndexToSlot.IsValidIndex(PolyIndex))
+	{
+		return nullptr;
+	}
+
+	const FRPGNavTilePolys& TilePolys = TilesPolys[TileIndex];
+	OutSlot = TilePolys.PolyIndexToSlot[PolyIndex];
+
+	//a stale ref to a rebuilt tile can land on a different poly
+	if (OutSlot == INDEX_NONE || TilePolys.PolyRefs[OutSlot] != PolyRef)
+	{
+		return nullptr;
+	}
+
+	return &TilePolys;
+}
+
+#if WITH_RECAST
+bool ARPGRecastNavMesh::FindCachedCorridor(const FPathCacheKey& Key, const dtNavMesh* DetourMesh, FPathCacheEntry& OutEntry) const
+{
+	FScopeLock Lock(&PathCacheLock);
+
+	if (DetourMesh != PathCacheDetourMesh)
+	{
+		return false;
+	}
+
+	FPathCacheEntry* Entry = PathCache.Find(Key);
+	if (!Entry)
+	{
+		return false;
+	}
+
+	//refs are salted, a poly that was removed without a tile update notification (e.g. streamed out) fails here
+	for (const NavNodeRef PolyRef : Entry->Corridor)
+	{
+		if (!DetourMesh->isValidPolyRef(PolyRef))
+		{
+			PathCache.Remove(Key);
+			return false;
+		}
+	}
+
+	Entry->LastUsed = ++PathCacheUseCounter;
+	OutEntry = *Entry;
+	return true;
+}
+
+void ARPGRecastNavMesh::AddCachedCorridor(const FPathCacheKey& Key, const dtNavMesh* DetourMesh, const FPathCacheEntry& Entry) const
+{
+	FScopeLock Lock(&PathCacheLock);
+
+	if (DetourMesh != PathCacheDetourMesh)
+	{
+		PathCache.Reset();
+		PathCacheDetourMesh = DetourMesh;
+	}
+
+	if (MaxCachedPaths <= 0)
+	{
+		return;
+	}
+
+	if (PathCache.Num() >= MaxCachedPaths && !PathCache.Contains(Key))
+	{
+		//least recently used, the cache is small enough for a linear search
+		auto OldestIt = PathCache.CreateIterator();
+		for (auto It = PathCache.CreateIterator(); It; ++It)
+		{
+			if (It.Value().LastUsed < OldestIt.Value().LastUsed)
+			{
+				OldestIt = It;
+			}
+		}
+		OldestIt.RemoveCurrent();
+	}
+
+	FPathCacheEntry& NewEntry = PathCache.Add(Key, Entry);
+	NewEntry.LastUsed = ++PathCacheUseCounter;
+}
+
+dtNavMeshQuery* ARPGRecastNavMesh::AcquireNavQuery(const dtNavMesh* DetourMesh, int32 MaxSearchNodes) const
+{
+	dtNavMeshQuery* NavQuery = nullptr;
+	{
+		FScopeLock Lock(&PathCacheLock);
+		if (FreeNavQueries.Num() > 0)
+		{
+			NavQuery = FreeNavQueries.Pop(false);
+		}
+	}
+
+	if (!NavQuery)
+	{
+		NavQuery = new dtNavMeshQuery();
+	}
+
+	//reuses the node pool when it is already big enough, MaxSearchNodes is what bounds the search
+	if (dtStatusFailed(NavQuery->init(DetourMesh, MaxSearchNodes)))
+	{
+		delete NavQuery;
+		return nullptr;
+	}
+
+	return NavQuery;
+}
+
+void ARPGRecastNavMesh::ReleaseNavQuery(dtNavMeshQuery* NavQuery) const
+{
+	FScopeLock Lock(&PathCacheLock);
+	FreeNavQueries.Add(NavQuery);
+}
+#endif // WITH_RECAST
@@ -2,6 +2,9 @@
 
 
 #include "Abilities/RPGAbilityTargetActor_SingleLineTrace.h"
+#include "Abilities/RPGAbilityTargetTypes.h"
+#include "Abilities/GameplayAbility.h"
+#include "GameFramework/PlayerController.h"
 #include "DrawDebugHelpers.h"
 
 ARPGAbilityTargetActor_SingleLineTrace::ARPGAbilityTargetActor_SingleLineTrace(const FObjectInitializer& ObjectInitializer)
@@ -15,35 +18,36 @@ void ARPGAbilityTargetActor_SingleLineTrace::ConfirmTargetingAndContinue()
 	check(ShouldProduceTargetData());
 	if (SourceActor)
 	{
-		FGameplayAbilityTargetDataHandle Handle = MakeTargetData(PerformTrace(SourceActor));
+		//compact hit instead of MakeTargetData's FGameplayAbilityTargetData_SingleTargetHit, this is sent to the server for every shot
+		FGameplayAbilityTargetDataHandle Handle(new FRPGGameplayAbilityTargetData_LineTraceHit(PerformTrace(SourceActor)));
 		TargetDataReadyDelegate.Broadcast(Handle);
 	}
 }
 
-FHitResult ARPGAbilityTargetActor_SingleLineTrace::PerformTrace(AActor* InSourceActor)
+void ARPGAbilityTargetActor_SingleLineTrace::StartTargeting(UGameplayAbility* Ability)
 {
-	bool bTraceComplex = false;
-	TArray<AActor*> ActorsToIgnore;
+	if (AGameplayAbilityWorldReticle* LocalReticleActor = ReticleActor.Get())
+	{
+		LocalReticleActor->Destroy();
+		ReticleActor.Reset();
+	}
 
-	ActorsToIgnore.Add(InSourceActor);
+	//a reusable actor had ticking turned off when its last task ended, the reticle and the trace are updated in Tick
+	SetActorTickEnabled(true);
 
-	FCollisionQueryParams Params(SCENE_QUERY_STAT(AGameplayAbilityTargetActor_SingleLineTrace), bTraceComplex);
-	Params.bReturnPhysicalMaterial = true;
-	Params.AddIgnoredActors(ActorsToIgnore);
+	Super::StartTargeting(Ability);
+}
+
+FHitResult ARPGAbilityTargetActor_SingleLineTrace::PerformTrace(AActor* InSourceActor)
+{
+	//only the server and the launching client have the owning ability, same as AimWithPlayerController
+	APlayerController* PC = OwningAbility ? OwningAbility->GetCurrentActorInfo()->PlayerController.Get() : nullptr;
 
-	FVector TraceStart = StartLocation.GetTargetingTransform().GetLocation();// InSourceActor->GetActorLocation();
+	const FVector TraceStart = StartLocation.GetTargetingTransform().GetLocation();// InSourceActor->GetActorLocation();
 	FVector TraceEnd;
-	AimWithPlayerController(InSourceActor, Params, TraceStart, TraceEnd);		//Effective on server and launching client only
 
-	// ------------------------------------------------------
+	FHitResult ReturnHitResult = PerformLineTrace(InSourceActor, PC, TraceStart, MaxRange, Filter, TraceProfile.Name, bTraceAffectsAimPitch, TraceEnd);
 
-	FHitResult ReturnHitResult;
-	LineTraceWithFilter(ReturnHitResult, InSourceActor->GetWorld(), Filter, TraceStart, TraceEnd, TraceProfile.Name, Params);
-	//Default to end of trace line if we don't hit anything.
-	if (!ReturnHitResult.bBlockingHit)
-	{
-		ReturnHitResult.Location = TraceEnd;
-	}
 	if (AGameplayAbilityWorldReticle* LocalReticleActor = ReticleActor.Get())
 	{
 		const bool bHitActor = (ReturnHitResult.bBlockingHit && (ReturnHitResult.Actor != NULL));
@@ -63,3 +67,70 @@ FHitResult ARPGAbilityTargetActor_SingleLineTrace::PerformTrace(AActor* InSource
 
 	return ReturnHitResult;
 }
+
+FHitResult ARPGAbilityTargetActor_SingleLineTrace::PerformLineTrace(const AActor* InSourceActor, APlayerController* PC, const FVector& TraceStart, float InMaxRange, const FGameplayTargetDataFilterHandle& InFilter, FName InTraceProfile, bool bInTraceAffectsAimPitch, FVector& OutTraceEnd)
+{
+	check(InSourceActor);
+
+	bool bTraceComplex = false;
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(AGameplayAbilityTargetActor_SingleLineTrace), bTraceComplex);
+	Params.bReturnPhysicalMaterial = true;
+	Params.AddIgnoredActor(InSourceActor);
+
+	const UWorld* World = InSourceActor->GetWorld();
+
+	//default to the source actor's facing if there is no controller to aim with
+	OutTraceEnd = TraceStart + InSourceActor->GetActorForwardVector() * InMaxRange;
+
+	if (PC)
+	{
+		FVector ViewStart;
+		FRotator ViewRot;
+		PC->GetPlayerViewPoint(ViewStart, ViewRot);
+
+		const FVector ViewDir = ViewRot.Vector();
+		FVector ViewEnd = ViewStart + (ViewDir * InMaxRange);
+
+		ClipCameraRayToAbilityRange(ViewStart, ViewDir, TraceStart, InMaxRange, ViewEnd);
+
+		FHitResult ViewHitResult;
+		LineTraceWithFilter(ViewHitResult, World, InFilter, ViewStart, ViewEnd, InTraceProfile, Params);
+
+		const bool bUseTraceResult = ViewHitResult.bBlockingHit && (FVector::DistSquared(TraceStart, ViewHitResult.Location) <= (InMaxRange * InMaxRange));
+		const FVector AdjustedEnd = bUseTraceResult ? ViewHitResult.Location : ViewEnd;
+
+		FVector AdjustedAimDir = (AdjustedEnd - TraceStart).GetSafeNormal();
+		if (AdjustedAimDir.IsZero())
+		{
+			AdjustedAimDir = ViewDir;
+		}
+
+		if (!bInTraceAffectsAimPitch && bUseTraceResult)
+		{
+			const FVector OriginalAimDir = (ViewEnd - TraceStart).GetSafeNormal();
+			if (!OriginalAimDir.IsZero())
+			{
+				//keep the original pitch
+				FRotator AdjustedAimRot = AdjustedAimDir.Rotation();
+				AdjustedAimRot.Pitch = OriginalAimDir.Rotation().Pitch;
+
+				AdjustedAimDir = AdjustedAimRot.Vector();
+			}
+		}
+
+		OutTraceEnd = TraceStart + (AdjustedAimDir * InMaxRange);
+	}
+
+	// ------------------------------------------------------
+
+	FHitResult ReturnHitResult;
+	LineTraceWithFilter(ReturnHitResult, World, InFilter, TraceStart, OutTraceEnd, InTraceProfile, Params);
+	//Default to end of trace line if we don't hit anything.
+	if (!ReturnHitResult.bBlockingHit)
+	{
+		ReturnHitResult.Location = OutTraceEnd;
+	}
+
+	return ReturnHitResult;
+}
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Abilities/RPGAbilityTargetTypes.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "GameFramework/Actor.h"
+#include "Engine/PackageMapClient.h"
+
+namespace RPGLineTraceHitFlags
+{
+	enum Type : uint8
+	{
+		BlockingHit = 1 << 0,
+		HitActor = 1 << 1,
+		BoneIndex = 1 << 2,
+
+		NumBits = 3
+	};
+}
+
+FRPGGameplayAbilityTargetData_LineTraceHit::FRPGGameplayAbilityTargetData_LineTraceHit()
+	: TraceStart(ForceInitToZero), Location(ForceInitToZero), Normal(ForceInitToZero), BoneIndex(INDEX_NONE), bBlockingHit(false)
+{
+
+}
+
+FRPGGameplayAbilityTargetData_LineTraceHit::FRPGGameplayAbilityTargetData_LineTraceHit(const FHitResult& InHitResult)
+	: HitActor(InHitResult.Actor), TraceStart(InHitResult.TraceStart), Location(InHitResult.Location), Normal(InHitResult.Normal), BoneIndex(INDEX_NONE), bBlockingHit(InHitResult.bBlockingHit)
+{
+	//only the bone index is sent, a bone of any other mesh on the actor (weapons, attachments) would get the wrong name on the other side
+	const USkinnedMeshComponent* SkinnedMesh = Cast<USkinnedMeshComponent>(InHitResult.Component.Get());
+	if (SkinnedMesh && InHitResult.BoneName != NAME_None && SkinnedMesh == FindBoneMesh(InHitResult.GetActor()))
+	{
+		const int32 HitBoneIndex = SkinnedMesh->GetBoneIndex(InHitResult.BoneName);
+		BoneIndex = HitBoneIndex <= MAX_int16 ? (int16)HitBoneIndex : INDEX_NONE;
+	}
+
+	//the local copy keeps everything, only the serialized fields go over the network
+	HitResult = InHitResult;
+}
+
+TArray<TWeakObjectPtr<AActor>> FRPGGameplayAbilityTargetData_LineTraceHit::GetActors() const
+{
+	TArray<TWeakObjectPtr<AActor>> Actors;
+	if (HitActor.IsValid())
+	{
+		Actors.Add(HitActor);
+	}
+
+	return Actors;
+}
+
+FTransform FRPGGameplayAbilityTargetData_LineTraceHit::GetOrigin() const
+{
+	return FTransform((Location - TraceStart).Rotation(), TraceStart);
+}
+
+FString FRPGGameplayAbilityTargetData_LineTraceHit::ToString() const
+{
+	return FString::Printf(TEXT("FRPGGameplayAbilityTargetData_LineTraceHit %s at %s bone %d"), *GetNameSafe(HitActor.Get()), *Location.ToString(), BoneIndex);
+}
+
+bool FRPGGameplayAbilityTargetData_LineTraceHit::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Flags = 0;
+	if (Ar.IsSaving())
+	{
+		Flags |= bBlockingHit ? RPGLineTraceHitFlags::BlockingHit : 0;
+		Flags |= HitActor.IsValid() ? RPGLineTraceHitFlags::HitActor : 0;
+		Flags |= BoneIndex != INDEX_NONE ? RPGLineTraceHitFlags::BoneIndex : 0;
+	}
+
+	Ar.SerializeBits(&Flags, RPGLineTraceHitFlags::NumBits);
+	bBlockingHit = (Flags & RPGLineTraceHitFlags::BlockingHit) != 0;
+
+	bOutSuccess = true;
+
+	if (Flags & RPGLineTraceHitFlags::HitActor)
+	{
+		UObject* Actor = HitActor.Get();
+		bOutSuccess &= Map->SerializeObject(Ar, AActor::StaticClass(), Actor);
+		HitActor = Cast<AActor>(Actor);
+	}
+	else
+	{
+		HitActor = nullptr;
+	}
+
+	bool bSuccess = true;
+	TraceStart.NetSerialize(Ar, Map, bSuccess);
+	bOutSuccess &= bSuccess;
+
+	Location.NetSerialize(Ar, Map, bSuccess);
+	bOutSuccess &= bSuccess;
+
+	if (bBlockingHit)
+	{
+		Normal.NetSerialize(Ar, Map, bSuccess);
+		bOutSuccess &= bSuccess;
+	}
+
+	if (Flags & RPGLineTraceHitFlags::BoneIndex)
+	{
+		uint32 PackedBoneIndex = (uint32)BoneIndex;
+		Ar.SerializeIntPacked(PackedBoneIndex);
+		BoneIndex = (int16)PackedBoneIndex;
+	}
+	else
+	{
+		BoneIndex = INDEX_NONE;
+	}
+
+	if (Ar.IsLoading())
+	{
+		RebuildHitResult();
+	}
+
+	return true;
+}
+
+void FRPGGameplayAbilityTargetData_LineTraceHit::RebuildHitResult()
+{
+	HitResult = FHitResult(HitActor.Get(), nullptr, Location, Normal);
+	HitResult.bBlockingHit = bBlockingHit;
+	HitResult.TraceStart = TraceStart;
+	HitResult.TraceEnd = Location;
+
+	AActor* Actor = HitActor.Get();
+	if (!Actor)
+	{
+		return;
+	}
+
+	//the bone and component are looked up on the receiving side instead of being sent
+	USkinnedMeshComponent* SkinnedMesh = BoneIndex != INDEX_NONE ? FindBoneMesh(Actor) : nullptr;
+	if (SkinnedMesh)
+	{
+		HitResult.Component = SkinnedMesh;
+		HitResult.BoneName = SkinnedMesh->GetBoneName(BoneIndex);
+	}
+	else
+	{
+		HitResult.Component = Cast<UPrimitiveComponent>(Actor->GetRootComponent());
+	}
+}
+
+USkinnedMeshComponent* FRPGGameplayAbilityTargetData_LineTraceHit::FindBoneMesh(const AActor* Actor)
+{
+	return Actor ? Actor->FindComponentByClass<USkinnedMeshComponent>() : nullptr;
+}
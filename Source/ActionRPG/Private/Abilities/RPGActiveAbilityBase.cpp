@@ -6,6 +6,10 @@
 #include "Character/RPGCharacterBase.h"
 #include "Character/RPGInventoryComponent.h"
 #include "Animation/AnimMontage.h"
+#include "Abilities/RPGDamageExecutionCalculation.h"
+#include "Abilities/RPGTargetActorPoolSubsystem.h"
+#include "Abilities/GameplayAbilityTargetActor.h"
+#include "RPGGameplayTags.h"
 
 URPGActiveAbilityBase::URPGActiveAbilityBase(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -40,10 +44,62 @@ URPGActiveAbilityBase::URPGActiveAbilityBase(const FObjectInitializer& ObjectIni
 
 	bDamageSetByCaller = true;
 	BaseDamage = 0.0f;
+
+	BatchedDamageMinTargets = 4;
+
+	PrewarmTargetActorClass = nullptr;
+	PrewarmTargetActorCount = 2;
+
+	CachedCooldownInputBindingSerial = 0;
+	bCachedCooldownPlayerControlled = false;
+	bCooldownTagsCached = false;
 }
 
 const FGameplayTagContainer* URPGActiveAbilityBase::GetCooldownTags() const
 {
+	UpdateCooldownTagsCache();
+
+	return &InternalUnionCooldownTags;
+}
+
+void URPGActiveAbilityBase::UpdateCooldownTagsCache() const
+{
+	const ARPGCharacterBase* AvatarCharacter = Cast<ARPGCharacterBase>(GetAvatarActorFromActorInfo());
+
+	//ai would return null since the inventory component will not be set during OnPossessedBy
+	const URPGInventoryComponent* InventoryComponent = AvatarCharacter ? AvatarCharacter->GetInventoryComponent() : nullptr;
+
+	const FGameplayAbilitySpecHandle SpecHandle = GetCurrentAbilitySpecHandle();
+	const uint32 InputBindingSerial = InventoryComponent ? InventoryComponent->GetInputBindingSerial() : 0;
+	const bool bPlayerControlled = CurrentActorInfo && CurrentActorInfo->PlayerController.IsValid();
+
+	//the CDO is shared between every spec so never trust its cache
+	const bool bCanCache = !HasAnyFlags(RF_ClassDefaultObject);
+
+	if (bCanCache && bCooldownTagsCached && CachedCooldownSpecHandle == SpecHandle && CachedCooldownInputBindingSerial == InputBindingSerial && bCachedCooldownPlayerControlled == bPlayerControlled)
+	{
+		return;
+	}
+
+	CachedAdditionalCooldownTags.Reset();
+
+	//we need to get the cool down for the current equipped slot only if the controller is a player controller
+	if (bPlayerControlled && InventoryComponent)
+	{
+		const ERPGAbilityInputID AbilityInput = InventoryComponent->GetAbilityHandleInputID(SpecHandle);
+		CachedAdditionalCooldownTags.AppendTags(InventoryComponent->GetAbilityInputCooldownTag(AbilityInput)); //get the input slot cool down tags
+	}
+
+	if (bCooldownTagsInAbility)
+	{
+		CachedAdditionalCooldownTags.AppendTags(AbilityCooldownTags); //add the ability specific cool downs
+	}
+
+	if (CachedAdditionalCooldownTags.Num() == 0)
+	{
+		UE_LOG(LogAbilitySystem, Warning, TEXT("Ability %s URPGActiveAbilityBase::GetAdditionalCooldownTags empty, make sure ability or input slot has cooldown tags"), *GetName());
+	}
+
 	FGameplayTagContainer* MutableTags = const_cast<FGameplayTagContainer*>(&InternalUnionCooldownTags);
 	MutableTags->Reset();
 
@@ -55,14 +111,17 @@ const FGameplayTagContainer* URPGActiveAbilityBase::GetCooldownTags() const
 	}
 
 	//add the input cool down to the mutable tags
-	MutableTags->AppendTags(GetAdditionalCooldownTags());
+	MutableTags->AppendTags(CachedAdditionalCooldownTags);
 
 	if (MutableTags->Num() <= 0)
 	{
 		UE_LOG(LogAbilitySystem, Warning, TEXT("Ability %s GetCooldownTags Empty"), *GetName());
 	}
 
-	return MutableTags;
+	CachedCooldownSpecHandle = SpecHandle;
+	CachedCooldownInputBindingSerial = InputBindingSerial;
+	bCachedCooldownPlayerControlled = bPlayerControlled;
+	bCooldownTagsCached = bCanCache;
 }
 
 void URPGActiveAbilityBase::ApplyCooldown(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo) const
@@ -77,7 +136,7 @@ void URPGActiveAbilityBase::ApplyCooldown(const FGameplayAbilitySpecHandle Handl
 
 		if (bCooldownSetByCaller)
 		{
-			SpecHandle.Data.Get()->SetSetByCallerMagnitude(FGameplayTag::RequestGameplayTag(FName("Data.CooldownDuration")), GetCooldownDuration());
+			SpecHandle.Data.Get()->SetSetByCallerMagnitude(FRPGGameplayTags::Data_CooldownDuration, GetCooldownDuration());
 		}
 		
 		ApplyGameplayEffectSpecToOwner(Handle, ActorInfo, ActivationInfo, SpecHandle);
@@ -145,39 +204,11 @@ float URPGActiveAbilityBase::GetBaseDamage() const
 	return BaseDamage;
 }
 
-FGameplayTagContainer URPGActiveAbilityBase::GetAdditionalCooldownTags() const
+const FGameplayTagContainer& URPGActiveAbilityBase::GetAdditionalCooldownTags() const
 {
-	const ARPGCharacterBase* AvatarCharacter = Cast<ARPGCharacterBase>(GetAvatarActorFromActorInfo());
+	UpdateCooldownTagsCache();
 
-	//an ai might not use the inventory system instead use pre-defined abilities, but this will still need to work on them too
-	if (!AvatarCharacter)
-	{
-		//return empty
-		return FGameplayTagContainer();
-	}
-
-	FGameplayTagContainer CooldownTags;
-
-	//we need to get the cool down for the current equipped slot only if the controller is a player controller
-	const URPGInventoryComponent* InventoryComponent = AvatarCharacter->GetInventoryComponent(); //ai would return null since the inventory component will not be set during OnPossessedBy
-	if (GetActorInfo().PlayerController.IsValid() && InventoryComponent)
-	{
-		const FGameplayAbilitySpecHandle SpecHandle = GetCurrentAbilitySpecHandle();
-		const ERPGAbilityInputID AbilityInput = InventoryComponent->GetAbilityHandleInputID(SpecHandle);
-		CooldownTags.AppendTags(InventoryComponent->GetAbilityInputCooldownTag(AbilityInput)); //get the input slot cool down tags
-	}
-
-	if (bCooldownTagsInAbility)
-	{
-		CooldownTags.AppendTags(AbilityCooldownTags); //add the ability specific cool downs
-	}
-
-	if (CooldownTags.Num() == 0)
-	{
-		UE_LOG(LogAbilitySystem, Warning, TEXT("Ability %s URPGActiveAbilityBase::GetAdditionalCooldownTags empty, make sure ability or input slot has cooldown tags"), *GetName());
-	}
-
-	return CooldownTags;
+	return CachedAdditionalCooldownTags;
 }
 
 void URPGActiveAbilityBase::ApplyDamageEffectToTargetData_Implementation(const FGameplayAbilityTargetDataHandle& TargetData) const
@@ -203,10 +234,23 @@ void URPGActiveAbilityBase::ApplyDamageEffectToTargetData_Implementation(const F
 			{
 				//#TODO calculate the damage with critical hit chance and damage %
 				float DamageMagnitude = GetDamage();
-				DamageSpec->SetSetByCallerMagnitude(FGameplayTag::RequestGameplayTag(FName("Data.Damage")), DamageMagnitude);
+				DamageSpec->SetSetByCallerMagnitude(FRPGGameplayTags::Data_Damage, DamageMagnitude);
+			}
+
+			//when we hit a lot of targets, evaluate the armor for all of them in one go, the hit events are still sent by each execution
+			FRPGDamageBatch DamageBatch;
+			if (BatchedDamageMinTargets > 0 && DamageBatch.AddTargets(TargetData) >= BatchedDamageMinTargets)
+			{
+				DamageBatch.SetSourceSpec(*DamageSpec);
+				DamageBatch.Evaluate();
+
+				FRPGScopedDamageBatch ScopedDamageBatch(DamageBatch);
+				ApplyGameplayEffectSpecToTarget(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo, DamageSpecHandle, TargetData);
+			}
+			else
+			{
+				ApplyGameplayEffectSpecToTarget(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo, DamageSpecHandle, TargetData);
 			}
-	
-			ApplyGameplayEffectSpecToTarget(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo, DamageSpecHandle, TargetData);
 		}
 	}
 	else
@@ -216,6 +260,24 @@ void URPGActiveAbilityBase::ApplyDamageEffectToTargetData_Implementation(const F
 }
 
 
+void URPGActiveAbilityBase::OnGiveAbility(const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilitySpec& Spec)
+{
+	Super::OnGiveAbility(ActorInfo, Spec);
+
+	const AActor* OwnerActor = ActorInfo ? ActorInfo->OwnerActor.Get() : nullptr;
+	UWorld* World = OwnerActor ? OwnerActor->GetWorld() : nullptr;
+	if (!PrewarmTargetActorClass || PrewarmTargetActorCount <= 0 || !World)
+	{
+		return;
+	}
+
+	//the pool is shared by everyone with this ability, it's only filled up to the count once
+	if (URPGTargetActorPoolSubsystem* Pool = World->GetSubsystem<URPGTargetActorPoolSubsystem>())
+	{
+		Pool->Prewarm(PrewarmTargetActorClass, PrewarmTargetActorCount);
+	}
+}
+
 bool URPGActiveAbilityBase::K2_HasAuthority() const
 {
 	const FGameplayAbilityActorInfo* const CurrentActorInfoPtr = GetCurrentActorInfo();
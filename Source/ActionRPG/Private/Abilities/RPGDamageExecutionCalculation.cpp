@@ -4,6 +4,8 @@
 #include "Abilities/RPGDamageExecutionCalculation.h"
 #include "Character/RPGAttributeSetBase.h"
 #include "AbilitySystemBlueprintLibrary.h"
+#include "AbilitySystemGlobals.h"
+#include "RPGGameplayTags.h"
 
 struct FRPGDamageStatics
 {
@@ -33,10 +35,112 @@ static const FRPGDamageStatics& DamageStatics()
 	return Statics;
 }
 
+const FRPGDamageBatch* FRPGDamageBatch::ActiveBatch = nullptr;
+
+int32 FRPGDamageBatch::AddTargets(const FGameplayAbilityTargetDataHandle& TargetData)
+{
+	for (int32 DataIndex = 0; DataIndex < TargetData.Num(); DataIndex++)
+	{
+		const FGameplayAbilityTargetData* Data = TargetData.Get(DataIndex);
+		if (!Data)
+		{
+			continue;
+		}
+
+		for (const TWeakObjectPtr<AActor>& WeakActor : Data->GetActors())
+		{
+			AActor* Actor = WeakActor.Get();
+			UAbilitySystemComponent* AbilitySystem = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Actor);
+
+			if (AbilitySystem && !TargetIndices.Contains(AbilitySystem))
+			{
+				TargetIndices.Add(AbilitySystem, TargetAbilitySystems.Num());
+				TargetAbilitySystems.Add(AbilitySystem);
+			}
+		}
+	}
+
+	return Num();
+}
+
+void FRPGDamageBatch::Evaluate()
+{
+	const int32 TargetNum = Num();
+
+	TargetTags.SetNum(TargetNum);
+	TargetArmor.SetNumUninitialized(TargetNum);
+	DamageMultipliers.SetNumUninitialized(TargetNum);
+
+	FAggregatorEvaluateParameters EvaluationParameters;
+	EvaluationParameters.SourceTags = &SourceTags;
+
+	//gather first, then run the math over the contiguous arrays
+	for (int32 Index = 0; Index < TargetNum; Index++)
+	{
+		//the same tags the spec captures from the target when it's applied
+		TargetTags[Index].Reset();
+		TargetAbilitySystems[Index]->GetOwnedGameplayTags(TargetTags[Index]);
+
+		EvaluationParameters.TargetTags = &TargetTags[Index];
+		TargetArmor[Index] = URPGDamageExecutionCalculation::EvaluateArmor(TargetAbilitySystems[Index], EvaluationParameters);
+	}
+
+	URPGDamageExecutionCalculation::CalculateArmorDamageMultipliers(TargetArmor.GetData(), DamageMultipliers.GetData(), TargetNum);
+}
+
+void FRPGDamageBatch::SetSourceSpec(const FGameplayEffectSpec& Spec)
+{
+	const FGameplayEffectContextHandle& Context = Spec.GetContext();
+
+	SourceEffect = Spec.Def;
+	SourceAbility = Context.GetAbilityInstance_NotReplicated();
+	SourceAbilitySystem = Context.GetInstigatorAbilitySystemComponent();
+
+	SourceTags.Reset();
+	if (const FGameplayTagContainer* CapturedSourceTags = Spec.CapturedSourceTags.GetAggregatedTags())
+	{
+		SourceTags = *CapturedSourceTags;
+	}
+}
+
+bool FRPGDamageBatch::MatchesSpec(const FGameplayEffectSpec& Spec) const
+{
+	//the target data makes a copy of the spec and duplicates the context for each target, so compare what the copies keep
+	const FGameplayEffectContextHandle& Context = Spec.GetContext();
+
+	return SourceEffect && Spec.Def == SourceEffect
+		&& Context.GetAbilityInstance_NotReplicated() == SourceAbility
+		&& Context.GetInstigatorAbilitySystemComponent() == SourceAbilitySystem;
+}
+
+const float* FRPGDamageBatch::FindDamageMultiplier(const UAbilitySystemComponent* TargetAbilitySystem) const
+{
+	const int32* FoundIndex = TargetIndices.Find(TargetAbilitySystem);
+
+	return (FoundIndex && DamageMultipliers.IsValidIndex(*FoundIndex)) ? &DamageMultipliers[*FoundIndex] : nullptr;
+}
+
+const FRPGDamageBatch* FRPGDamageBatch::FindActive(const FGameplayEffectSpec& Spec)
+{
+	check(IsInGameThread());
+	return (ActiveBatch && ActiveBatch->MatchesSpec(Spec)) ? ActiveBatch : nullptr;
+}
+
+FRPGScopedDamageBatch::FRPGScopedDamageBatch(const FRPGDamageBatch& Batch)
+{
+	check(IsInGameThread());
+	PreviousBatch = FRPGDamageBatch::ActiveBatch;
+	FRPGDamageBatch::ActiveBatch = &Batch;
+}
+
+FRPGScopedDamageBatch::~FRPGScopedDamageBatch()
+{
+	FRPGDamageBatch::ActiveBatch = PreviousBatch;
+}
+
 URPGDamageExecutionCalculation::URPGDamageExecutionCalculation()
 {
 	RelevantAttributesToCapture.Add(DamageStatics().DamageDef);
-	RelevantAttributesToCapture.Add(DamageStatics().ArmorDef);
 }
 
 void URPGDamageExecutionCalculation::Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, OUT FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const
@@ -48,6 +152,25 @@ void URPGDamageExecutionCalculation::Execute_Implementation(const FGameplayEffec
 	AActor* TargetActor = TargetAbilitySystemComponent ? TargetAbilitySystemComponent->AvatarActor : nullptr;
 
 	const FGameplayEffectSpec& Spec = ExecutionParams.GetOwningSpec();
+
+	// SetByCaller Damage, damage should always be positive
+	float UnmitigatedDamage = FMath::Max<float>(Spec.GetSetByCallerMagnitude(FRPGGameplayTags::Data_Damage), 0.0f);
+
+	//if the target is part of a damage batch made for this spec, then the armor was already evaluated by the ability
+	const FRPGDamageBatch* DamageBatch = FRPGDamageBatch::FindActive(Spec);
+	const float* BatchedMultiplier = DamageBatch ? DamageBatch->FindDamageMultiplier(TargetAbilitySystemComponent) : nullptr;
+	if (BatchedMultiplier)
+	{
+		const float BatchedMitigatedDamage = UnmitigatedDamage * (*BatchedMultiplier);
+		if (BatchedMitigatedDamage > 0.f)
+		{
+			OutExecutionOutput.AddOutputModifier(FGameplayModifierEvaluatedData(DamageStatics().DamageProperty, EGameplayModOp::Additive, BatchedMitigatedDamage));
+		}
+
+		SendReceiveHitEvent(SourceActor, TargetActor, UnmitigatedDamage);
+		return;
+	}
+
 	FGameplayTagContainer AssetTags;
 	Spec.GetAllAssetTags(AssetTags);
 
@@ -59,30 +182,56 @@ void URPGDamageExecutionCalculation::Execute_Implementation(const FGameplayEffec
 	EvaluationParameters.SourceTags = SourceTags;
 	EvaluationParameters.TargetTags = TargetTags;
 
-	float Armor = 0.0f;
-	ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().ArmorDef, EvaluationParameters, Armor);
-	Armor = FMath::Max<float>(Armor, 0.0f);
+	const float Armor = FMath::Max<float>(EvaluateArmor(TargetAbilitySystemComponent, EvaluationParameters), 0.0f);
 
-	// SetByCaller Damage, damage should always be positive
-	float UnmitigatedDamage = FMath::Max<float>(Spec.GetSetByCallerMagnitude(FGameplayTag::RequestGameplayTag(FName("Data.Damage"))), 0.0f);
+	//https://dota2.gamepedia.com/Armor
+	//for now use https://leagueoflegends.fandom.com/wiki/Armor 100 / (100 + armor), easier calculation
+	const float DamageMultiplier = CalculateArmorDamageMultiplier(Armor);
+	const float MitigatedDamage = UnmitigatedDamage * DamageMultiplier;
 
+	if (MitigatedDamage > 0.f)
+	{
+		// Set the Target's damage meta attribute
+		OutExecutionOutput.AddOutputModifier(FGameplayModifierEvaluatedData(DamageStatics().DamageProperty, EGameplayModOp::Additive, MitigatedDamage));
+	}
+
+	SendReceiveHitEvent(SourceActor, TargetActor, UnmitigatedDamage);
+}
+
+void URPGDamageExecutionCalculation::SendReceiveHitEvent(AActor* SourceActor, AActor* TargetActor, float UnmitigatedDamage)
+{
 	//send the game play event, Event.ReceiveHit to hit actor, this is the unmitigatedDamage, before armor or reflection etc.
-	FGameplayTag EventTag(FGameplayTag::RequestGameplayTag(FName("Event.ReceiveHit"))); //#TODO send a different tag if attack missed? Event.ReceiveMissedHit
+	const FGameplayTag& EventTag = FRPGGameplayTags::Event_ReceiveHit; //#TODO send a different tag if attack missed? Event.ReceiveMissedHit
 	FGameplayEventData Payload;
 	Payload.Instigator = SourceActor;
 	Payload.Target = TargetActor;
 	Payload.EventMagnitude = UnmitigatedDamage;
 	UAbilitySystemBlueprintLibrary::SendGameplayEventToActor(TargetActor, EventTag, Payload); //use the blueprint library
+}
 
-	//https://dota2.gamepedia.com/Armor
-	//for now use https://leagueoflegends.fandom.com/wiki/Armor 100 / (100 + armor), easier calculation
-	const float DamageMultiplier = CalculateArmorDamageMultiplier(Armor);
-	const float MitigatedDamage = UnmitigatedDamage * DamageMultiplier;
+float URPGDamageExecutionCalculation::EvaluateArmor(UAbilitySystemComponent* TargetAbilitySystem, const FAggregatorEvaluateParameters& EvaluationParameters)
+{
+	if (!TargetAbilitySystem)
+	{
+		return 0.0f;
+	}
 
-	if (MitigatedDamage > 0.f)
+	//same as a non snapshot capture from the target, it references the target's armor aggregator
+	FGameplayEffectAttributeCaptureSpec CaptureSpec(DamageStatics().ArmorDef);
+	TargetAbilitySystem->CaptureAttributeForGameplayEffect(CaptureSpec);
+
+	float Armor = 0.0f;
+	CaptureSpec.AttemptCalculateAttributeMagnitude(EvaluationParameters, Armor);
+	return Armor;
+}
+
+void URPGDamageExecutionCalculation::CalculateArmorDamageMultipliers(const float* ArmorValues, float* OutMultipliers, int32 Num)
+{
+	//branch free so the compiler can vectorize it, same as CalculateArmorDamageMultiplier for armor >= 0
+	for (int32 Index = 0; Index < Num; Index++)
 	{
-		// Set the Target's damage meta attribute
-		OutExecutionOutput.AddOutputModifier(FGameplayModifierEvaluatedData(DamageStatics().DamageProperty, EGameplayModOp::Additive, MitigatedDamage));
+		const float Armor = FMath::Max(ArmorValues[Index], 0.0f);
+		OutMultipliers[Index] = 100.0f / (100.0f + Armor);
 	}
 }
 
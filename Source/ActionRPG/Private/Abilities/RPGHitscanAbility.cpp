@@ -2,4 +2,150 @@
 
 
 #include "Abilities/RPGHitscanAbility.h"
+#include "Abilities/RPGAbilityTargetActor_SingleLineTrace.h"
+#include "Abilities/RPGLagCompensationSubsystem.h"
+#include "Abilities/RPGAbilityTargetTypes.h"
+#include "AbilitySystemComponent.h"
+#include "Components/SkeletalMeshComponent.h"
 
+URPGHitscanAbility::URPGHitscanAbility(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	NetExecutionPolicy = EGameplayAbilityNetExecutionPolicy::LocalPredicted;
+
+	MaxRange = 999999.0f;
+	bTraceAffectsAimPitch = true;
+	TraceStartSocketName = NAME_None;
+}
+
+void URPGHitscanAbility::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+{
+	if (!CommitAbility(Handle, ActorInfo, ActivationInfo))
+	{
+		EndAbility(Handle, ActorInfo, ActivationInfo, true, true);
+		return;
+	}
+
+	UAbilitySystemComponent* AbilitySystemComponent = ActorInfo->AbilitySystemComponent.Get();
+	check(AbilitySystemComponent);
+
+	if (ActorInfo->IsLocallyControlled())
+	{
+		const FGameplayAbilityTargetDataHandle TargetData = PerformHitscan();
+
+		if (!ActorInfo->IsNetAuthority())
+		{
+			//still inside the activation prediction window, so the target data goes up with the activation key, no new key is generated
+			FScopedPredictionWindow ScopedPrediction(AbilitySystemComponent, !AbilitySystemComponent->ScopedPredictionKey.IsValidForMorePrediction());
+
+			FGameplayTag ApplicationTag;
+			AbilitySystemComponent->CallServerSetReplicatedTargetData(Handle, ActivationInfo.GetActivationPredictionKey(), TargetData, ApplicationTag, AbilitySystemComponent->ScopedPredictionKey);
+		}
+
+		HandleTargetData(TargetData);
+	}
+	else
+	{
+		//server for a remote client, wait for the client's trace (it may already be here)
+		const FPredictionKey ActivationPredictionKey = ActivationInfo.GetActivationPredictionKey();
+
+		ServerTargetDataSetHandle = AbilitySystemComponent->AbilityTargetDataSetDelegate(Handle, ActivationPredictionKey).AddUObject(this, &URPGHitscanAbility::OnServerTargetDataReceived);
+		ServerTargetDataCancelledHandle = AbilitySystemComponent->AbilityTargetDataCancelledDelegate(Handle, ActivationPredictionKey).AddUObject(this, &URPGHitscanAbility::OnServerTargetDataCancelled);
+
+		AbilitySystemComponent->CallReplicatedTargetDataDelegatesIfSet(Handle, ActivationPredictionKey);
+	}
+}
+
+void URPGHitscanAbility::EndAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, bool bReplicateEndAbility, bool bWasCancelled)
+{
+	ClearServerTargetDataDelegates();
+
+	Super::EndAbility(Handle, ActorInfo, ActivationInfo, bReplicateEndAbility, bWasCancelled);
+}
+
+FGameplayAbilityTargetDataHandle URPGHitscanAbility::PerformHitscan() const
+{
+	const FGameplayAbilityActorInfo* ActorInfo = GetCurrentActorInfo();
+	AActor* AvatarActor = ActorInfo ? ActorInfo->AvatarActor.Get() : nullptr;
+	if (!AvatarActor)
+	{
+		return FGameplayAbilityTargetDataHandle();
+	}
+
+	FVector TraceStart = AvatarActor->GetActorLocation();
+	if (!TraceStartSocketName.IsNone())
+	{
+		if (USkeletalMeshComponent* Mesh = ActorInfo->SkeletalMeshComponent.Get())
+		{
+			TraceStart = Mesh->GetSocketLocation(TraceStartSocketName);
+		}
+	}
+
+	FVector TraceEnd;
+	const FHitResult HitResult = ARPGAbilityTargetActor_SingleLineTrace::PerformLineTrace(AvatarActor, ActorInfo->PlayerController.Get(), TraceStart, MaxRange, Filter, TraceProfile.Name, bTraceAffectsAimPitch, TraceEnd);
+
+	//same target data the target actor sends in ConfirmTargetingAndContinue
+	return FGameplayAbilityTargetDataHandle(new FRPGGameplayAbilityTargetData_LineTraceHit(HitResult));
+}
+
+void URPGHitscanAbility::HandleTargetData(const FGameplayAbilityTargetDataHandle& TargetData)
+{
+	K2_OnHitscanTargetData(TargetData);
+
+	//only applies on authority
+	ApplyDamageEffectToTargetData(TargetData);
+
+	EndAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo, true, false);
+}
+
+void URPGHitscanAbility::OnServerTargetDataReceived(const FGameplayAbilityTargetDataHandle& Data, FGameplayTag ActivationTag)
+{
+	UAbilitySystemComponent* AbilitySystemComponent = CurrentActorInfo ? CurrentActorInfo->AbilitySystemComponent.Get() : nullptr;
+	if (!AbilitySystemComponent)
+	{
+		return;
+	}
+
+	//copy before consuming, Data points into the cached data
+	const FGameplayAbilityTargetDataHandle TargetData = Data;
+	AbilitySystemComponent->ConsumeClientReplicatedTargetData(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey());
+
+	ClearServerTargetDataDelegates();
+
+	//the client is trusted with the trace, but not with hits outside of the rewound hitboxes
+	const UWorld* World = GetWorld();
+	const URPGLagCompensationSubsystem* LagCompensation = World ? World->GetSubsystem<URPGLagCompensationSubsystem>() : nullptr;
+	if (LagCompensation && !LagCompensation->ValidateTargetData(TargetData, CurrentActorInfo))
+	{
+		EndAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo, true, true);
+		return;
+	}
+
+	HandleTargetData(TargetData);
+}
+
+void URPGHitscanAbility::OnServerTargetDataCancelled()
+{
+	ClearServerTargetDataDelegates();
+	EndAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo, true, true);
+}
+
+void URPGHitscanAbility::ClearServerTargetDataDelegates()
+{
+	if (!ServerTargetDataSetHandle.IsValid() && !ServerTargetDataCancelledHandle.IsValid())
+	{
+		return;
+	}
+
+	UAbilitySystemComponent* AbilitySystemComponent = CurrentActorInfo ? CurrentActorInfo->AbilitySystemComponent.Get() : nullptr;
+	if (AbilitySystemComponent)
+	{
+		const FPredictionKey ActivationPredictionKey = CurrentActivationInfo.GetActivationPredictionKey();
+
+		AbilitySystemComponent->AbilityTargetDataSetDelegate(CurrentSpecHandle, ActivationPredictionKey).Remove(ServerTargetDataSetHandle);
+		AbilitySystemComponent->AbilityTargetDataCancelledDelegate(CurrentSpecHandle, ActivationPredictionKey).Remove(ServerTargetDataCancelledHandle);
+	}
+
+	ServerTargetDataSetHandle.Reset();
+	ServerTargetDataCancelledHandle.Reset();
+}
@@ -0,0 +1,254 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Abilities/RPGLagCompensationSubsystem.h"
+#include "Abilities/GameplayAbilityTypes.h"
+#include "Character/RPGCharacterBase.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("RPGLagCompensation: record snapshots"), STAT_RPGLagCompensation_Record, STATGROUP_Game);
+
+float FRPGHitboxSnapshot::GetDistanceToPoint(const FVector& Point) const
+{
+	const FVector Up = Rotation.GetUpVector();
+	const float SegmentHalfLength = FMath::Max(HalfHeight - Radius, 0.0f);
+
+	return FMath::PointDistToSegment(Point, Location - Up * SegmentHalfLength, Location + Up * SegmentHalfLength) - Radius;
+}
+
+FRPGHitboxSnapshot FRPGHitboxSnapshot::Interpolate(const FRPGHitboxSnapshot& A, const FRPGHitboxSnapshot& B, float Time)
+{
+	const float Range = B.Time - A.Time;
+	const float Alpha = Range > KINDA_SMALL_NUMBER ? FMath::Clamp((Time - A.Time) / Range, 0.0f, 1.0f) : 1.0f;
+
+	FRPGHitboxSnapshot Result;
+	Result.Time = Time;
+	Result.Location = FMath::Lerp(A.Location, B.Location, Alpha);
+	Result.Rotation = FQuat::Slerp(A.Rotation, B.Rotation, Alpha);
+	Result.Radius = FMath::Lerp(A.Radius, B.Radius, Alpha);
+	Result.HalfHeight = FMath::Lerp(A.HalfHeight, B.HalfHeight, Alpha);
+
+	return Result;
+}
+
+void FRPGHitboxHistory::Init(ARPGCharacterBase* InCharacter, int32 MaxSnapshots)
+{
+	Character = InCharacter;
+	CharacterKey = InCharacter;
+	Snapshots.SetNumUninitialized(FMath::Max(MaxSnapshots, 2));
+	Head = -1;
+	Num = 0;
+}
+
+void FRPGHitboxHistory::Add(const FRPGHitboxSnapshot& Snapshot)
+{
+	Head = (Head + 1) % Snapshots.Num();
+	Snapshots[Head] = Snapshot;
+	Num = FMath::Min(Num + 1, Snapshots.Num());
+}
+
+bool FRPGHitboxHistory::GetAtTime(float Time, FRPGHitboxSnapshot& OutSnapshot) const
+{
+	if (Num == 0)
+	{
+		return false;
+	}
+
+	const FRPGHitboxSnapshot& Newest = GetFromNewest(0);
+	if (Time >= Newest.Time)
+	{
+		OutSnapshot = Newest;
+		return true;
+	}
+
+	//walk back from the newest, the buffer is small so this is cheaper than a binary search over the ring
+	for (int32 Age = 1; Age < Num; Age++)
+	{
+		const FRPGHitboxSnapshot& Older = GetFromNewest(Age);
+		if (Older.Time <= Time)
+		{
+			OutSnapshot = FRPGHitboxSnapshot::Interpolate(Older, GetFromNewest(Age - 1), Time);
+			return true;
+		}
+	}
+
+	OutSnapshot = GetFromNewest(Num - 1);
+	return true;
+}
+
+URPGLagCompensationSubsystem::URPGLagCompensationSubsystem()
+{
+	bEnabled = true;
+	MaxSnapshots = 32;
+	MaxRewindTime = 0.5f;
+	ClientInterpolationDelay = 0.1f;
+	HitTolerance = 30.0f;
+	MaxTraceStartDistance = 300.0f;
+}
+
+void URPGLagCompensationSubsystem::RegisterCharacter(ARPGCharacterBase* Character)
+{
+	if (!Character || HistoryIndices.Contains(Character))
+	{
+		return;
+	}
+
+	const int32 Index = Histories.AddDefaulted();
+	Histories[Index].Init(Character, MaxSnapshots);
+	HistoryIndices.Add(Character, Index);
+}
+
+void URPGLagCompensationSubsystem::UnregisterCharacter(ARPGCharacterBase* Character)
+{
+	if (const int32* Index = HistoryIndices.Find(Character))
+	{
+		RemoveHistoryAt(*Index);
+	}
+}
+
+void URPGLagCompensationSubsystem::RemoveHistoryAt(int32 Index)
+{
+	HistoryIndices.Remove(Histories[Index].CharacterKey);
+
+	Histories.RemoveAtSwap(Index, 1, false);
+	if (Histories.IsValidIndex(Index))
+	{
+		HistoryIndices.Add(Histories[Index].CharacterKey, Index);
+	}
+}
+
+bool URPGLagCompensationSubsystem::ValidateHit(const ARPGCharacterBase* HitCharacter, const FVector& HitLocation, float Time) const
+{
+	const int32* Index = HistoryIndices.Find(HitCharacter);
+	if (!Index)
+	{
+		return true;
+	}
+
+	FRPGHitboxSnapshot Snapshot;
+	if (!Histories[*Index].GetAtTime(Time, Snapshot))
+	{
+		return true;
+	}
+
+	return Snapshot.GetDistanceToPoint(HitLocation) <= HitTolerance;
+}
+
+bool URPGLagCompensationSubsystem::ValidateTargetData(const FGameplayAbilityTargetDataHandle& TargetData, const FGameplayAbilityActorInfo* ActorInfo) const
+{
+	if (!bEnabled || !ActorInfo)
+	{
+		return true;
+	}
+
+	const float ClientViewTime = GetClientViewTime(ActorInfo);
+
+	//the instigator is the autonomous proxy, its position on the server is already where it fired from so it isn't rewound
+	FRPGHitboxSnapshot InstigatorSnapshot;
+	const ARPGCharacterBase* InstigatorCharacter = Cast<ARPGCharacterBase>(ActorInfo->AvatarActor.Get());
+	const bool bHasInstigatorSnapshot = MakeSnapshot(InstigatorCharacter, ClientViewTime, InstigatorSnapshot);
+
+	for (int32 DataIndex = 0; DataIndex < TargetData.Num(); DataIndex++)
+	{
+		const FGameplayAbilityTargetData* Data = TargetData.Get(DataIndex);
+		if (!Data || !Data->HasHitResult())
+		{
+			continue;
+		}
+
+		const FHitResult* HitResult = Data->GetHitResult();
+
+		if (bHasInstigatorSnapshot && InstigatorSnapshot.GetDistanceToPoint(HitResult->TraceStart) > MaxTraceStartDistance)
+		{
+			UE_LOG(LogTemp, Verbose, TEXT("URPGLagCompensationSubsystem: rejected target data from %s, trace started too far from the instigator"), *GetNameSafe(InstigatorCharacter));
+			return false;
+		}
+
+		const ARPGCharacterBase* HitCharacter = Cast<ARPGCharacterBase>(HitResult->GetActor());
+		if (HitCharacter && HitResult->bBlockingHit && !ValidateHit(HitCharacter, HitResult->Location, ClientViewTime))
+		{
+			UE_LOG(LogTemp, Verbose, TEXT("URPGLagCompensationSubsystem: rejected target data from %s, hit on %s is not on the rewound hitbox"), *GetNameSafe(InstigatorCharacter), *GetNameSafe(HitCharacter));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+float URPGLagCompensationSubsystem::GetClientViewTime(const FGameplayAbilityActorInfo* ActorInfo) const
+{
+	const UWorld* World = GetWorld();
+	const float ServerTime = World ? World->GetTimeSeconds() : 0.0f;
+
+	const APlayerController* PC = ActorInfo ? ActorInfo->PlayerController.Get() : nullptr;
+	const APlayerState* PlayerState = PC ? PC->PlayerState : nullptr;
+	if (!PlayerState || PC->IsLocalController())
+	{
+		return ServerTime;
+	}
+
+	//ExactPing is the round trip in ms, the other characters reach the client half a trip late and are shown another interpolation delay behind that
+	const float RewindTime = FMath::Min(PlayerState->ExactPing * 0.0005f + ClientInterpolationDelay, MaxRewindTime);
+	return ServerTime - RewindTime;
+}
+
+void URPGLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	RecordSnapshots();
+}
+
+bool URPGLagCompensationSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return bEnabled && World && World->IsGameWorld() && World->GetNetMode() != NM_Client && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId URPGLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URPGLagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void URPGLagCompensationSubsystem::RecordSnapshots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RPGLagCompensation_Record);
+
+	const float Time = GetWorld()->GetTimeSeconds();
+
+	//backwards so the removed histories are swapped with ones that were already recorded
+	for (int32 Index = Histories.Num() - 1; Index >= 0; Index--)
+	{
+		FRPGHitboxHistory& History = Histories[Index];
+
+		//the character was destroyed without unregistering
+		if (!History.Character.IsValid())
+		{
+			RemoveHistoryAt(Index);
+			continue;
+		}
+
+		FRPGHitboxSnapshot Snapshot;
+		if (MakeSnapshot(History.Character.Get(), Time, Snapshot))
+		{
+			History.Add(Snapshot);
+		}
+	}
+}
+
+bool URPGLagCompensationSubsystem::MakeSnapshot(const ARPGCharacterBase* Character, float Time, FRPGHitboxSnapshot& OutSnapshot)
+{
+	const UCapsuleComponent* Capsule = Character ? Character->GetCapsuleComponent() : nullptr;
+	if (!Capsule)
+	{
+		return false;
+	}
+
+	OutSnapshot.Time = Time;
+	OutSnapshot.Location = Capsule->GetComponentLocation();
+	OutSnapshot.Rotation = Capsule->GetComponentQuat();
+	Capsule->GetScaledCapsuleSize(OutSnapshot.Radius, OutSnapshot.HalfHeight);
+
+	return true;
+}
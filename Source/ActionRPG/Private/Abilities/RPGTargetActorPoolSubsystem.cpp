@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Abilities/RPGTargetActorPoolSubsystem.h"
+#include "Abilities/GameplayAbilityTargetActor.h"
+#include "Engine/World.h"
+
+URPGTargetActorPoolSubsystem::URPGTargetActorPoolSubsystem()
+{
+	MaxFreeActorsPerClass = 16;
+}
+
+bool URPGTargetActorPoolSubsystem::CanPoolClass(TSubclassOf<AGameplayAbilityTargetActor> Class)
+{
+	if (!Class)
+	{
+		return false;
+	}
+
+	const AGameplayAbilityTargetActor* CDO = Class->GetDefaultObject<AGameplayAbilityTargetActor>();
+	return CDO && !CDO->GetIsReplicated();
+}
+
+AGameplayAbilityTargetActor* URPGTargetActorPoolSubsystem::AcquireActor(TSubclassOf<AGameplayAbilityTargetActor> Class, bool& bOutNeedsFinishSpawning)
+{
+	bOutNeedsFinishSpawning = false;
+
+	if (!Class)
+	{
+		return nullptr;
+	}
+
+	if (FRPGTargetActorPoolList* Pool = Pools.Find(*Class))
+	{
+		while (Pool->FreeActors.Num() > 0)
+		{
+			AGameplayAbilityTargetActor* PooledActor = Pool->FreeActors.Pop(false);
+
+			//something else may have destroyed it while it was in the pool
+			if (PooledActor && !PooledActor->IsPendingKill())
+			{
+				//ticking was turned off by ReleaseActor
+				PooledActor->SetActorTickEnabled(PooledActor->PrimaryActorTick.bStartWithTickEnabled);
+				return PooledActor;
+			}
+		}
+	}
+
+	AGameplayAbilityTargetActor* SpawnedActor = SpawnActorDeferred(Class);
+	bOutNeedsFinishSpawning = SpawnedActor != nullptr;
+
+	return SpawnedActor;
+}
+
+void URPGTargetActorPoolSubsystem::ReleaseActor(AGameplayAbilityTargetActor* TargetActor)
+{
+	if (!TargetActor || TargetActor->IsPendingKill())
+	{
+		return;
+	}
+
+	FRPGTargetActorPoolList& Pool = Pools.FindOrAdd(TargetActor->GetClass());
+	if (Pool.FreeActors.Num() >= MaxFreeActorsPerClass)
+	{
+		TargetActor->Destroy();
+		return;
+	}
+
+	TargetActor->SetActorTickEnabled(false);
+	TargetActor->MasterPC = nullptr;
+	TargetActor->SourceActor = nullptr;
+
+	Pool.FreeActors.AddUnique(TargetActor);
+}
+
+void URPGTargetActorPoolSubsystem::Prewarm(TSubclassOf<AGameplayAbilityTargetActor> Class, int32 Count)
+{
+	if (!CanPoolClass(Class))
+	{
+		return;
+	}
+
+	FRPGTargetActorPoolList& Pool = Pools.FindOrAdd(*Class);
+	const int32 NumToSpawn = FMath::Min(Count, MaxFreeActorsPerClass) - Pool.FreeActors.Num();
+
+	for (int32 Index = 0; Index < NumToSpawn; Index++)
+	{
+		AGameplayAbilityTargetActor* SpawnedActor = SpawnActorDeferred(Class);
+		if (!SpawnedActor)
+		{
+			break;
+		}
+
+		SpawnedActor->FinishSpawning(FTransform::Identity);
+
+		//pooled actors are returned by the task, never destroyed on confirmation
+		SpawnedActor->bDestroyOnConfirmation = false;
+		ReleaseActor(SpawnedActor);
+	}
+}
+
+AGameplayAbilityTargetActor* URPGTargetActorPoolSubsystem::SpawnActorDeferred(TSubclassOf<AGameplayAbilityTargetActor> Class) const
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	return World->SpawnActorDeferred<AGameplayAbilityTargetActor>(*Class, FTransform::Identity, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+}
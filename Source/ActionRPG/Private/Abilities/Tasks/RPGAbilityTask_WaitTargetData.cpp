@@ -2,12 +2,17 @@
 
 
 #include "Abilities/Tasks/RPGAbilityTask_WaitTargetData.h"
+#include "Abilities/RPGTargetActorPoolSubsystem.h"
+#include "Abilities/RPGLagCompensationSubsystem.h"
 #include "AbilitySystemComponent.h"
 
 URPGAbilityTask_WaitTargetData::URPGAbilityTask_WaitTargetData(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
-
+	bCreateKeyIfNotValidForMorePredicting = false;
+	bReusableActor = false;
+	bPooledActor = false;
+	bPooledActorNeedsFinishSpawning = false;
 }
 
 void URPGAbilityTask_WaitTargetData::OnTargetDataReplicatedCallback(const FGameplayAbilityTargetDataHandle& Data, FGameplayTag ActivationTag)
@@ -26,7 +31,13 @@ void URPGAbilityTask_WaitTargetData::OnTargetDataReplicatedCallback(const FGamep
 	 *	explicitly, the client is basically just sending a 'confirm' and the server is now going to do the work
 	 *	in OnReplicatedTargetDataReceived.
 	 */
-	if (TargetActor && !TargetActor->OnReplicatedTargetDataReceived(MutableData))
+	//FRPGGameplayAbilityTargetData_LineTraceHit rebuilds its hit result in NetSerialize, so the compact line trace hits are read here
+	//through GetHitResult like any other hit, the bone and component are resolved from the hit actor on this side
+	//rewind the hitboxes to what the client saw and reject hits it could not have made
+	const URPGLagCompensationSubsystem* LagCompensation = GetWorld() ? GetWorld()->GetSubsystem<URPGLagCompensationSubsystem>() : nullptr;
+	const bool bValidHits = !LagCompensation || LagCompensation->ValidateTargetData(MutableData, Ability ? Ability->GetCurrentActorInfo() : nullptr);
+
+	if (!bValidHits || (TargetActor && !TargetActor->OnReplicatedTargetDataReceived(MutableData)))
 	{
 		if (ShouldBroadcastAbilityTaskDelegates())
 		{
@@ -124,7 +135,10 @@ URPGAbilityTask_WaitTargetData* URPGAbilityTask_WaitTargetData::WaitTargetData(U
 	MyObj->TargetClass = InTargetClass;
 	MyObj->TargetActor = nullptr;
 	MyObj->ConfirmationType = ConfirmationType;
+	MyObj->bCreateKeyIfNotValidForMorePredicting = bCreateKeyIfNotValidForMorePredicting;
 	MyObj->bReusableActor = false;
+	MyObj->bPooledActor = false;
+	MyObj->bPooledActorNeedsFinishSpawning = false;
 	return MyObj;
 }
 
@@ -135,6 +149,8 @@ URPGAbilityTask_WaitTargetData* URPGAbilityTask_WaitTargetData::WaitTargetDataUs
 	MyObj->ConfirmationType = ConfirmationType;
 	MyObj->bCreateKeyIfNotValidForMorePredicting = bCreateKeyIfNotValidForMorePredicting;
 	MyObj->bReusableActor = bReusableActor;
+	MyObj->bPooledActor = false;
+	MyObj->bPooledActorNeedsFinishSpawning = false;
 	return MyObj;
 }
 
@@ -151,7 +167,17 @@ bool URPGAbilityTask_WaitTargetData::BeginSpawningActor(UGameplayAbility* Owning
 			{
 				if (UWorld* World = GEngine->GetWorldFromContextObject(OwningAbility, EGetWorldErrorMode::LogAndReturnNull))
 				{
-					SpawnedActor = World->SpawnActorDeferred<AGameplayAbilityTargetActor>(Class, FTransform::Identity, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+					//take the actor from the pool when we can, it's returned in OnDestroy instead of being destroyed
+					URPGTargetActorPoolSubsystem* Pool = World->GetSubsystem<URPGTargetActorPoolSubsystem>();
+					if (Pool && URPGTargetActorPoolSubsystem::CanPoolClass(InTargetClass))
+					{
+						SpawnedActor = Pool->AcquireActor(InTargetClass, bPooledActorNeedsFinishSpawning);
+						bPooledActor = SpawnedActor != nullptr;
+					}
+					else
+					{
+						SpawnedActor = World->SpawnActorDeferred<AGameplayAbilityTargetActor>(Class, FTransform::Identity, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+					}
 				}
 			}
 
@@ -176,7 +202,21 @@ void URPGAbilityTask_WaitTargetData::FinishSpawningActor(UGameplayAbility* Ownin
 
 		const FTransform SpawnTransform = AbilitySystemComponent->GetOwner()->GetTransform();
 
-		SpawnedActor->FinishSpawning(SpawnTransform);
+		if (!bPooledActor || bPooledActorNeedsFinishSpawning)
+		{
+			SpawnedActor->FinishSpawning(SpawnTransform);
+		}
+		else
+		{
+			//already spawned, reused from the pool
+			SpawnedActor->SetActorTransform(SpawnTransform);
+		}
+
+		if (bPooledActor)
+		{
+			//the pool owns the actor, set after the exposed on spawn properties were assigned
+			SpawnedActor->bDestroyOnConfirmation = false;
+		}
 
 		FinalizeTargetActor(SpawnedActor);
 	}
@@ -335,10 +375,9 @@ void URPGAbilityTask_WaitTargetData::RegisterTargetDataCallbacks()
 
 	const bool bIsLocallyControlled = Ability->GetCurrentActorInfo()->IsLocallyControlled();
 
-	//changed to check the passed in actor instead of the CDO
-	//const AGameplayAbilityTargetActor* CDO = CastChecked<AGameplayAbilityTargetActor>(TargetClass->GetDefaultObject());
-	//const bool bShouldProduceTargetDataOnServer = CDO->ShouldProduceTargetDataOnServer;
-	const bool bShouldProduceTargetDataOnServer = TargetActor->ShouldProduceTargetDataOnServer;
+	//changed to check the passed in actor instead of the CDO, the server doesn't spawn an actor for a remote client's non replicated target actor so fall back to the CDO then
+	const AGameplayAbilityTargetActor* TargetActorOrCDO = TargetActor ? TargetActor : (TargetClass ? TargetClass->GetDefaultObject<AGameplayAbilityTargetActor>() : nullptr);
+	const bool bShouldProduceTargetDataOnServer = TargetActorOrCDO && TargetActorOrCDO->ShouldProduceTargetDataOnServer;
 
 	// If not locally controlled (server for remote client), see if TargetData was already sent
 	// else register callback for when it does get here.
@@ -385,18 +424,24 @@ void URPGAbilityTask_WaitTargetData::OnDestroy(bool AbilityEnded)
 		//	TargetActor->GenericDelegateBoundASC = nullptr;
 		//}*/
 
-		if (bReusableActor)
+		if (bPooledActor)
 		{
-			// TargetActor doesn't have a StopTargeting function
-			TargetActor->SetActorTickEnabled(false);
-
-			// Clear added callbacks
-			TargetActor->TargetDataReadyDelegate.RemoveAll(this);
-			TargetActor->CanceledDelegate.RemoveAll(this);
+			ClearTargetActorCallbacks();
 
-			AbilitySystemComponent->GenericLocalConfirmCallbacks.RemoveDynamic(TargetActor, &AGameplayAbilityTargetActor::ConfirmTargeting);
-			AbilitySystemComponent->GenericLocalCancelCallbacks.RemoveDynamic(TargetActor, &AGameplayAbilityTargetActor::CancelTargeting);
-			TargetActor->GenericDelegateBoundASC = nullptr;
+			UWorld* World = GetWorld();
+			URPGTargetActorPoolSubsystem* Pool = World ? World->GetSubsystem<URPGTargetActorPoolSubsystem>() : nullptr;
+			if (Pool)
+			{
+				Pool->ReleaseActor(TargetActor);
+			}
+			else
+			{
+				TargetActor->Destroy();
+			}
+		}
+		else if (bReusableActor)
+		{
+			ClearTargetActorCallbacks();
 		}
 		else
 		{
@@ -408,6 +453,25 @@ void URPGAbilityTask_WaitTargetData::OnDestroy(bool AbilityEnded)
 	Super::OnDestroy(AbilityEnded);
 }
 
+void URPGAbilityTask_WaitTargetData::ClearTargetActorCallbacks()
+{
+	check(TargetActor);
+
+	// TargetActor doesn't have a StopTargeting function
+	TargetActor->SetActorTickEnabled(false);
+
+	// Clear added callbacks
+	TargetActor->TargetDataReadyDelegate.RemoveAll(this);
+	TargetActor->CanceledDelegate.RemoveAll(this);
+
+	if (AbilitySystemComponent)
+	{
+		AbilitySystemComponent->GenericLocalConfirmCallbacks.RemoveDynamic(TargetActor, &AGameplayAbilityTargetActor::ConfirmTargeting);
+		AbilitySystemComponent->GenericLocalCancelCallbacks.RemoveDynamic(TargetActor, &AGameplayAbilityTargetActor::CancelTargeting);
+	}
+	TargetActor->GenericDelegateBoundASC = nullptr;
+}
+
 bool URPGAbilityTask_WaitTargetData::ShouldReplicateDataToServer() const
 {
 	if (!Ability || !TargetActor)
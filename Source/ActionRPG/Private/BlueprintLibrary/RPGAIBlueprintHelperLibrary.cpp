@@ -2,6 +2,7 @@
 
 
 #include "BlueprintLibrary/RPGAIBlueprintHelperLibrary.h"
+#include "AI/RPGPawnSpatialSubsystem.h"
 #include "GameFramework/GameStateBase.h"
 #include "GameFramework/PlayerState.h"
 #include "GameFramework/Pawn.h"
@@ -11,46 +12,60 @@
 
 void URPGAIBlueprintHelperLibrary::GetNearestPlayerPawn(AActor* const &Querier, class APawn*& OutNearestPlayerPawn, float& OutDistance)
 {
+	OutNearestPlayerPawn = nullptr;
+	OutDistance = -1.0f;
+
 	if (!Querier)
 	{
-		OutNearestPlayerPawn = nullptr;
-		OutDistance = -1.0f;
+		return;
+	}
+
+	UWorld* World = Querier->GetWorld();
+	const FVector QuerierLocation = Querier->GetActorLocation();
+
+	//use the spatial grid once it has been built, this is called every BT tick by every AI so avoid walking the player array
+	URPGPawnSpatialSubsystem* SpatialSubsystem = World ? World->GetSubsystem<URPGPawnSpatialSubsystem>() : nullptr;
+	if (SpatialSubsystem && SpatialSubsystem->HasUpdated())
+	{
+		float DistanceSquared = -1.0f;
+		OutNearestPlayerPawn = SpatialSubsystem->FindNearestPlayerPawn(QuerierLocation, DistanceSquared);
+		OutDistance = OutNearestPlayerPawn ? FMath::Sqrt(DistanceSquared) : -1.0f;
 
 		return;
 	}
 
-	TArray<APlayerState*> PlayerArray = Querier->GetWorld()->GetGameState()->PlayerArray;
+	//fallback for the first frame before the subsystem has ticked
+	AGameStateBase* GameState = World ? World->GetGameState() : nullptr;
+	if (!GameState)
+	{
+		return;
+	}
+
+	const TArray<APlayerState*>& PlayerArray = GameState->PlayerArray;
 
 	APawn* NearestPawn = nullptr;
-	float MinDistance = -1.0f;
+	float MinDistanceSquared = BIG_NUMBER;
 
-	for (int32 Index = 0; Index < PlayerArray.Num(); Index++)
+	for (const APlayerState* PlayerState : PlayerArray)
 	{
-		APlayerState* PlayerState = PlayerArray[Index];
-		APawn* Pawn = PlayerState->GetPawn();
+		APawn* Pawn = PlayerState ? PlayerState->GetPawn() : nullptr;
 
-		if (!PlayerState->IsSpectator() && !PlayerState->IsOnlyASpectator())
+		if (Pawn && !PlayerState->IsSpectator() && !PlayerState->IsOnlyASpectator())
 		{
-			float Distance = (Querier->GetActorLocation() - Pawn->GetActorLocation()).Size();
-
-			if (NearestPawn) // if we already run this, we can't use index = 0 since the first pawn might be a spectator
-			{
-				if (Distance < MinDistance)
-				{
-					NearestPawn = Pawn;
-					MinDistance = Distance;
-				}
-			}
-			else
+			const float DistanceSquared = FVector::DistSquared(QuerierLocation, Pawn->GetActorLocation());
+			if (DistanceSquared < MinDistanceSquared)
 			{
 				NearestPawn = Pawn;
-				MinDistance = Distance;
+				MinDistanceSquared = DistanceSquared;
 			}
 		}
 	}
 
-	OutNearestPlayerPawn = NearestPawn;
-	OutDistance = MinDistance;
+	if (NearestPawn)
+	{
+		OutNearestPlayerPawn = NearestPawn;
+		OutDistance = FMath::Sqrt(MinDistanceSquared);
+	}
 }
 
 AActor* URPGAIBlueprintHelperLibrary::GetQueryResultsAsActor(const UEnvQueryInstanceBlueprintWrapper* const& Query)
@@ -19,6 +19,15 @@ URPGAnimInstanceBase::URPGAnimInstanceBase(const FObjectInitializer& ObjectIniti
 	bIsInAir = false;
 	bDoubleJumped = false;
 	JumpCount = 0;
+
+	LocomotionUpdateInterval[(uint8)ERPGSignificance::Hidden] = 0.25f;
+	LocomotionUpdateInterval[(uint8)ERPGSignificance::Low] = 0.1f;
+	LocomotionUpdateInterval[(uint8)ERPGSignificance::Medium] = 1.0f / 30.0f;
+	LocomotionUpdateInterval[(uint8)ERPGSignificance::High] = 0.0f;
+	DedicatedServerLocomotionUpdateInterval = 0.25f;
+
+	CurrentLocomotionUpdateInterval = 0.0f;
+	LocomotionTimeSinceUpdate = 0.0f;
 }
 
 
@@ -27,23 +36,42 @@ void URPGAnimInstanceBase::NativeInitializeAnimation()
 	Super::NativeInitializeAnimation();
 
 	OwnerCharacter = Cast<ACharacter>(GetOwningActor());
+
+	//the significance subsystem doesn't exist on a dedicated server
+	CurrentLocomotionUpdateInterval = IsRunningDedicatedServer() ? DedicatedServerLocomotionUpdateInterval : 0.0f;
+	LocomotionTimeSinceUpdate = 0.0f;
 }
 
 void URPGAnimInstanceBase::NativeUpdateAnimation(float DeltaSeconds)
 {
+	//the locomotion vars are updated by the proxy, see FRPGAnimInstanceProxy
 	Super::NativeUpdateAnimation(DeltaSeconds);
+}
 
-	UpdateLocomotionVars(DeltaSeconds);
+FAnimInstanceProxy* URPGAnimInstanceBase::CreateAnimInstanceProxy()
+{
+	return new FRPGAnimInstanceProxy(this);
 }
 
-void URPGAnimInstanceBase::UpdateLocomotionVars(float DeltaSeconds)
+void URPGAnimInstanceBase::SetSignificance(ERPGSignificance NewSignificance)
 {
-	if (!OwnerCharacter)
+	if (NewSignificance < ERPGSignificance::MAX)
 	{
-		return;
+		CurrentLocomotionUpdateInterval = LocomotionUpdateInterval[(uint8)NewSignificance];
 	}
+}
+
+void URPGAnimInstanceBase::GatherLocomotionSnapshot(FRPGLocomotionSnapshot& OutSnapshot) const
+{
+	OutSnapshot.Velocity = OwnerCharacter->GetVelocity();
+	OutSnapshot.ActorRotation = OwnerCharacter->GetActorRotation();
+	OutSnapshot.bIsFalling = OwnerCharacter->GetMovementComponent()->IsFalling();
+	OutSnapshot.JumpCurrentCount = OwnerCharacter->JumpCurrentCount;
+}
 
-	FVector Velocity = GetOwningActor()->GetVelocity();
+void URPGAnimInstanceBase::UpdateLocomotionVars(const FRPGLocomotionSnapshot& Snapshot, float DeltaSeconds)
+{
+	const FVector& Velocity = Snapshot.Velocity;
 	
 	MoveSpeed = Velocity.Size();
 	LocomotionPlayRate = MoveSpeed * (1.0f / BlendSpaceDefaultMoveSpeed);
@@ -51,7 +79,7 @@ void URPGAnimInstanceBase::UpdateLocomotionVars(float DeltaSeconds)
 	bIsMoving = MoveSpeed > 0.0f;
 
 	FRotator VelocityRot = Velocity.ToOrientationRotator();
-	LocomotionBSDirection = (bIsMoving) ? (VelocityRot - GetOwningActor()->GetActorRotation()).GetNormalized().Yaw : 0.0f;
+	LocomotionBSDirection = (bIsMoving) ? (VelocityRot - Snapshot.ActorRotation).GetNormalized().Yaw : 0.0f;
 	if (bLocomotionMovingForward && (LocomotionBSDirection < -95.0f || LocomotionBSDirection > 95.0f))
 	{
 		bLocomotionMovingForward = false;
@@ -67,10 +95,45 @@ void URPGAnimInstanceBase::UpdateLocomotionVars(float DeltaSeconds)
 	//if we haven't jumped before and we just just jumped now or we started falling then play the first jump animations
 	//if we didn't first jump and we haven't double jumped
 	//bool bJumped = !bIsInAir && OwnerCharacter->GetMovementComponent()->IsFalling() || NewJumpCount > JumpCount;
-	bIsInAir = OwnerCharacter->GetMovementComponent()->IsFalling();
+	bIsInAir = Snapshot.bIsFalling;
 
 	//b double jump if we haven't new jump count is greater than 1
-	const int32 NewJumpCount = OwnerCharacter->JumpCurrentCount;
+	const int32 NewJumpCount = Snapshot.JumpCurrentCount;
 	bDoubleJumped = NewJumpCount > JumpCount && NewJumpCount > 1;
 	JumpCount = NewJumpCount;
 }
+
+FRPGAnimInstanceProxy::FRPGAnimInstanceProxy(UAnimInstance* InAnimInstance)
+	: FAnimInstanceProxy(InAnimInstance), RPGAnimInstance(CastChecked<URPGAnimInstanceBase>(InAnimInstance)), bHasLocomotionSnapshot(false), LocomotionDeltaSeconds(0.0f)
+{
+
+}
+
+void FRPGAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+	FAnimInstanceProxy::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	//game thread, decide if the locomotion is updated this frame and copy what it needs
+	bHasLocomotionSnapshot = false;
+
+	RPGAnimInstance->LocomotionTimeSinceUpdate += DeltaSeconds;
+	if (RPGAnimInstance->OwnerCharacter && RPGAnimInstance->LocomotionTimeSinceUpdate >= RPGAnimInstance->CurrentLocomotionUpdateInterval)
+	{
+		RPGAnimInstance->GatherLocomotionSnapshot(LocomotionSnapshot);
+		LocomotionDeltaSeconds = RPGAnimInstance->LocomotionTimeSinceUpdate;
+		RPGAnimInstance->LocomotionTimeSinceUpdate = 0.0f;
+
+		bHasLocomotionSnapshot = true;
+	}
+}
+
+void FRPGAnimInstanceProxy::Update(float DeltaSeconds)
+{
+	FAnimInstanceProxy::Update(DeltaSeconds);
+
+	//worker thread when the update is parallel, only touches the snapshot and the instance's locomotion vars
+	if (bHasLocomotionSnapshot)
+	{
+		RPGAnimInstance->UpdateLocomotionVars(LocomotionSnapshot, LocomotionDeltaSeconds);
+	}
+}
@@ -10,13 +10,24 @@
 URPGAttributeSetBase::URPGAttributeSetBase(const FObjectInitializer& ObjectInitializer /*= FObjectInitializer::Get()*/)
 	: Super(ObjectInitializer), MaxHealth(100.0f), Health(100.0f), Armor(0.0f), Damage(0.0f)
 {
+	//until an AI possesses the owning character
+	bReplicateToAll = true;
+}
+
+void URPGAttributeSetBase::PreAttributeChange(const FGameplayAttribute& Attribute, float& NewValue)
+{
+	Super::PreAttributeChange(Attribute, NewValue);
 
+	MarkAttributeDirty(Attribute);
 }
 
 void URPGAttributeSetBase::PostGameplayEffectExecute(const struct FGameplayEffectModCallbackData& Data)
 {
 	Super::PostGameplayEffectExecute(Data);
 
+	//the base value changed, the current value might not have
+	MarkAttributeDirty(Data.EvaluatedData.Attribute);
+
 	FGameplayEffectContextHandle Context = Data.EffectSpec.GetContext();
 	UAbilitySystemComponent* Source = Context.GetOriginalInstigatorAbilitySystemComponent();
 	const FGameplayTagContainer& SourceTags = *Data.EffectSpec.CapturedSourceTags.GetAggregatedTags();
@@ -108,11 +119,56 @@ void URPGAttributeSetBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>&
 
 	/* REPTNOTIFY_Always tells the OnRep function to trigger if the local value is already equal to the value being replicated down from the Server (due to prediction).
 	 * By default it won't trigger the OnRep function if the local value is the same as the value being replicated down from the Server.
+	 * push based, the attributes are only compared after MarkAttributeDirty
+	 * custom condition, on for players and off for AI (SetReplicateToAll), simulated AI proxies use ARPGCharacterBase::HealthBarProxy
 	*/
-	DOREPLIFETIME_CONDITION_NOTIFY(URPGAttributeSetBase, MaxHealth, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(URPGAttributeSetBase, Health, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(URPGAttributeSetBase, Armor, COND_None, REPNOTIFY_Always);
+	FDoRepLifetimeParams Params;
+	Params.Condition = COND_Custom;
+	Params.RepNotifyCondition = REPNOTIFY_Always;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(URPGAttributeSetBase, MaxHealth, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(URPGAttributeSetBase, Health, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(URPGAttributeSetBase, Armor, Params);
+}
+
+void URPGAttributeSetBase::SetReplicateToAll(bool bInReplicateToAll)
+{
+	if (bReplicateToAll == bInReplicateToAll)
+	{
+		return;
+	}
+
+	bReplicateToAll = bInReplicateToAll;
+
+	//push model only compares dirty properties, so the ones turned back on need to be sent again
+	MarkAttributeDirty(GetMaxHealthAttribute());
+	MarkAttributeDirty(GetHealthAttribute());
+	MarkAttributeDirty(GetArmorAttribute());
+}
+
+void URPGAttributeSetBase::PreReplicationForOwner(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	//nobody owns an AI, so off is the same as owner only for them
+	DOREPLIFETIME_ACTIVE_OVERRIDE(URPGAttributeSetBase, MaxHealth, bReplicateToAll);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(URPGAttributeSetBase, Health, bReplicateToAll);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(URPGAttributeSetBase, Armor, bReplicateToAll);
+}
 
+void URPGAttributeSetBase::MarkAttributeDirty(const FGameplayAttribute& Attribute)
+{
+	if (Attribute == GetHealthAttribute())
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(URPGAttributeSetBase, Health, this);
+	}
+	else if (Attribute == GetMaxHealthAttribute())
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(URPGAttributeSetBase, MaxHealth, this);
+	}
+	else if (Attribute == GetArmorAttribute())
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(URPGAttributeSetBase, Armor, this);
+	}
 }
 
 void URPGAttributeSetBase::OnRep_MaxHealth(const FGameplayAttributeData& OldMaxHealth)
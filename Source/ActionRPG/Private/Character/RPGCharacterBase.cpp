@@ -8,6 +8,9 @@
 #include "Items/RPGInventoryItemBase.h"
 #include "Items/RPGMeleeWeaponActor.h"
 #include "UI/RPGInventoryUI.h"
+#include "AI/RPGPawnSpatialSubsystem.h"
+#include "Abilities/RPGLagCompensationSubsystem.h"
+#include "Character/RPGSignificanceSubsystem.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
@@ -15,6 +18,8 @@
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "Engine/NetDriver.h"
 #include "ActionRPG.h"
 
 #include "DrawDebugHelpers.h"
@@ -66,6 +71,13 @@ ARPGCharacterBase::ARPGCharacterBase(const FObjectInitializer& ObjectInitializer
 	AbilitySystemComponent->SetReplicationMode(EGameplayEffectReplicationMode::Mixed);
 	AbilitySystemComponent->SetIsReplicated(true);
 
+	//set from these when possessed
+	AIReplicationMode = EGameplayEffectReplicationMode::Minimal;
+	PlayerReplicationMode = EGameplayEffectReplicationMode::Mixed;
+
+	//let the engine skip/interpolate anim updates, URPGSignificanceSubsystem sets the frame skip from the significance bucket
+	GetMesh()->bEnableUpdateRateOptimizations = true;
+
 	CharacterAttributeSet = CreateDefaultSubobject<URPGAttributeSetBase>(ARPGCharacterBase::CharacterAttributeSetName);
 
 	InteractTraceDistance = 1000.0f;
@@ -85,9 +97,74 @@ void ARPGCharacterBase::PostInitializeComponents()
 	}
 }
 
+void ARPGCharacterBase::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (URPGPawnSpatialSubsystem* SpatialSubsystem = GetWorld()->GetSubsystem<URPGPawnSpatialSubsystem>())
+	{
+		SpatialSubsystem->RegisterPawn(this);
+	}
+
+	if (URPGSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<URPGSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->RegisterCharacter(this);
+	}
+
+	if (HasAuthority())
+	{
+		if (URPGLagCompensationSubsystem* LagCompensationSubsystem = GetWorld()->GetSubsystem<URPGLagCompensationSubsystem>())
+		{
+			LagCompensationSubsystem->RegisterCharacter(this);
+		}
+
+		BindHealthBarProxy();
+	}
+}
+
+void ARPGCharacterBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (URPGPawnSpatialSubsystem* SpatialSubsystem = GetWorld()->GetSubsystem<URPGPawnSpatialSubsystem>())
+	{
+		SpatialSubsystem->UnregisterPawn(this);
+	}
+
+	if (URPGSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<URPGSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->UnregisterCharacter(this);
+	}
+
+	if (URPGLagCompensationSubsystem* LagCompensationSubsystem = GetWorld()->GetSubsystem<URPGLagCompensationSubsystem>())
+	{
+		LagCompensationSubsystem->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void ARPGCharacterBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	//only for AI, players replicate their attribute set to everyone (PreReplication), nobody owns an AI so the owner is never sent it
+	FDoRepLifetimeParams Params;
+	Params.Condition = COND_Custom;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(ARPGCharacterBase, HealthBarProxy, Params);
+}
+
+void ARPGCharacterBase::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	UNetDriver* NetDriver = GetNetDriver();
+	if (CharacterAttributeSet && NetDriver)
+	{
+		CharacterAttributeSet->PreReplicationForOwner(*NetDriver->FindOrCreateRepChangedPropertyTracker(CharacterAttributeSet).Get());
+	}
+
+	DOREPLIFETIME_ACTIVE_OVERRIDE(ARPGCharacterBase, HealthBarProxy, !CharacterAttributeSet || !CharacterAttributeSet->GetReplicateToAll());
 }
 
 void ARPGCharacterBase::PossessedBy(AController* NewController)
@@ -113,7 +190,18 @@ void ARPGCharacterBase::PossessedBy(AController* NewController)
 	//we need to InitAbilityActorInfo for both the player and ai
 	if (AbilitySystemComponent)
 	{
+		const bool bPlayerControlled = NewController && NewController->IsPlayerController();
+		AbilitySystemComponent->SetReplicationMode(bPlayerControlled ? PlayerReplicationMode : AIReplicationMode);
 		AbilitySystemComponent->InitAbilityActorInfo(this, this);
+
+		//AI attributes are only needed on the server, their simulated proxies use the health bar proxy
+		if (CharacterAttributeSet)
+		{
+			CharacterAttributeSet->SetReplicateToAll(bPlayerControlled);
+
+			//push model only compares dirty properties, the proxy may have just been turned on
+			MARK_PROPERTY_DIRTY_FROM_NAME(ARPGCharacterBase, HealthBarProxy, this);
+		}
 	}
 }
 
@@ -255,6 +343,71 @@ URPGAttributeSetBase* ARPGCharacterBase::GetCharacterAttributeSet()
 	return CharacterAttributeSet;
 }
 
+float ARPGCharacterBase::GetHealthFraction() const
+{
+	//the attribute set isn't replicated to simulated proxies of AI, they get the proxy instead
+	if (!CharacterAttributeSet || (GetLocalRole() == ROLE_SimulatedProxy && !IsPlayerControlled()))
+	{
+		return HealthBarProxy.HealthFraction / 255.0f;
+	}
+
+	const float MaxHealth = CharacterAttributeSet->GetMaxHealth();
+	return MaxHealth > 0.0f ? FMath::Clamp(CharacterAttributeSet->GetHealth() / MaxHealth, 0.0f, 1.0f) : 0.0f;
+}
+
+bool ARPGCharacterBase::HasStateTag(FGameplayTag Tag) const
+{
+	//the minimal and mixed replication modes send the tags granted by gameplay effects to simulated proxies as well
+	return AbilitySystemComponent && AbilitySystemComponent->HasMatchingGameplayTag(Tag);
+}
+
+void ARPGCharacterBase::BindHealthBarProxy()
+{
+	if (!AbilitySystemComponent)
+	{
+		return;
+	}
+
+	AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(URPGAttributeSetBase::GetHealthAttribute()).AddUObject(this, &ARPGCharacterBase::OnHealthBarAttributeChanged);
+	AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(URPGAttributeSetBase::GetMaxHealthAttribute()).AddUObject(this, &ARPGCharacterBase::OnHealthBarAttributeChanged);
+
+	UpdateHealthBarProxy();
+}
+
+void ARPGCharacterBase::OnHealthBarAttributeChanged(const FOnAttributeChangeData& Data)
+{
+	UpdateHealthBarProxy();
+}
+
+void ARPGCharacterBase::UpdateHealthBarProxy()
+{
+	if (!CharacterAttributeSet)
+	{
+		return;
+	}
+
+	const float MaxHealth = CharacterAttributeSet->GetMaxHealth();
+	const float Fraction = MaxHealth > 0.0f ? CharacterAttributeSet->GetHealth() / MaxHealth : 0.0f;
+
+	//never round a living character down to an empty bar
+	uint8 HealthFraction = (uint8)FMath::Clamp(FMath::RoundToInt(Fraction * 255.0f), 0, 255);
+	if (HealthFraction == 0 && CharacterAttributeSet->GetHealth() > 0.0f)
+	{
+		HealthFraction = 1;
+	}
+
+	if (HealthFraction != HealthBarProxy.HealthFraction)
+	{
+		HealthBarProxy.HealthFraction = HealthFraction;
+		MARK_PROPERTY_DIRTY_FROM_NAME(ARPGCharacterBase, HealthBarProxy, this);
+	}
+}
+
+void ARPGCharacterBase::OnRep_HealthBarProxy()
+{
+	OnHealthBarProxyChanged.Broadcast(this);
+}
+
 void ARPGCharacterBase::OnAbilityEnd(const FAbilityEndedData& AbilityEndData)
 {
 	OnAbilityEnded.Broadcast(AbilityEndData.AbilityThatEnded, AbilityEndData.AbilitySpecHandle, AbilityEndData.bReplicateEndAbility, AbilityEndData.bWasCancelled);
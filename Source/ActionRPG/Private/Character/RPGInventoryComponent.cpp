@@ -4,23 +4,85 @@
 #include "Character/RPGInventoryComponent.h"
 #include "Character/RPGCharacterBase.h"
 #include "Items/RPGInventoryItemBase.h"
+#include "RPGGameplayTags.h"
 #include "AbilitySystemInterface.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
 #include "GameFramework/PlayerState.h"
 
+void FRPGInventorySlotData::PreReplicatedRemove(const FRPGInventorySlotArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnSlottedItemRemoved(*this);
+	}
+}
+
+void FRPGInventorySlotData::PostReplicatedAdd(const FRPGInventorySlotArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnSlottedItemAdded(*this);
+	}
+}
+
+void FRPGInventorySlotData::PostReplicatedChange(const FRPGInventorySlotArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnSlottedItemChanged(*this);
+	}
+}
+
+void FRPGLooseInventoryData::PreReplicatedRemove(const FRPGLooseInventoryArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnLooseItemRemoved(*this);
+	}
+}
+
+void FRPGLooseInventoryData::PostReplicatedAdd(const FRPGLooseInventoryArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnLooseItemAdded(*this);
+	}
+}
+
+void FRPGLooseInventoryData::PostReplicatedChange(const FRPGLooseInventoryArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnLooseItemChanged(*this);
+	}
+}
+
 // Sets default values for this component's properties
 URPGInventoryComponent::URPGInventoryComponent()
 {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
+	//nothing to do per frame, everything is driven by replication callbacks and input
+	PrimaryComponentTick.bCanEverTick = false;
 	SetIsReplicatedByDefault(true);
 
+	SlottedInventory.Owner = this;
+	LooseInventory.Owner = this;
+
+	for (int32 Index = 0; Index < (int32)ERPGInventorySlot::MAX; Index++)
+	{
+		SlotItemTable[Index] = nullptr;
+	}
+
+	InputBindingSerial = 0;
+	MarkInputBindingsChanged();
+
 	//default slot cool downs, weapons will not share slot cool down
 	//SlotCooldownTags.Add(ERPGInventorySlot::WeaponSlot1, FGameplayTagContainer(FGameplayTag::RequestGameplayTag(FName("Cooldown.Slot.WeaponSlot1"))));
 	//SlotCooldownTags.Add(ERPGInventorySlot::WeaponSlot2, FGameplayTagContainer(FGameplayTag::RequestGameplayTag(FName("Cooldown.Slot.WeaponSlot2"))));
-	AbilityInputCooldownTags.Add(ERPGAbilityInputID::Ability1, FGameplayTagContainer(FGameplayTag::RequestGameplayTag(FName("Cooldown.Input.Ability1"))));
-	AbilityInputCooldownTags.Add(ERPGAbilityInputID::Ability2, FGameplayTagContainer(FGameplayTag::RequestGameplayTag(FName("Cooldown.Input.Ability1"))));
+	//the CDO is constructed before URPGEngineSubsystem resolves the native tags
+	FRPGGameplayTags::InitializeNativeTags();
+	AbilityInputCooldownTags.Add(ERPGAbilityInputID::Ability1, FGameplayTagContainer(FRPGGameplayTags::Cooldown_Input_Ability1));
+	AbilityInputCooldownTags.Add(ERPGAbilityInputID::Ability2, FGameplayTagContainer(FRPGGameplayTags::Cooldown_Input_Ability2));
 }
 
 
@@ -28,10 +90,58 @@ void URPGInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(URPGInventoryComponent, SlottedInventory);
-	DOREPLIFETIME(URPGInventoryComponent, LooseInventory);
-	DOREPLIFETIME(URPGInventoryComponent, CurrentWeapon);
-	DOREPLIFETIME_CONDITION(URPGInventoryComponent, AbilityInputHandles, COND_OwnerOnly);
+	//push model, only compared after they are marked dirty with MARK_PROPERTY_DIRTY_FROM_NAME
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(URPGInventoryComponent, SlottedInventory, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(URPGInventoryComponent, LooseInventory, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(URPGInventoryComponent, CurrentWeapon, Params);
+
+	Params.Condition = COND_OwnerOnly;
+	DOREPLIFETIME_WITH_PARAMS_FAST(URPGInventoryComponent, AbilityInputHandles, Params);
+}
+
+void URPGInventoryComponent::SetSlotTableItem(ERPGInventorySlot Slot, ARPGInventoryItemBase* Item)
+{
+	if (Slot < ERPGInventorySlot::MAX)
+	{
+		SlotItemTable[(uint8)Slot] = Item;
+	}
+}
+
+void URPGInventoryComponent::MarkInputBindingsChanged()
+{
+	//0 is reserved for abilities without an inventory
+	static uint32 NextInputBindingSerial = 0;
+
+	if (++NextInputBindingSerial == 0)
+	{
+		++NextInputBindingSerial;
+	}
+
+	InputBindingSerial = NextInputBindingSerial;
+}
+
+void URPGInventoryComponent::RebuildInputHandleTables()
+{
+	for (int32 Index = 0; Index < (int32)ERPGAbilityInputID::MAX; Index++)
+	{
+		InputHandleTable[Index] = FGameplayAbilitySpecHandle();
+	}
+
+	SpecHandleInputMap.Reset();
+
+	for (const FRPGAbilityInputHandleData& InputData : AbilityInputHandles)
+	{
+		if (InputData.InputID < ERPGAbilityInputID::MAX)
+		{
+			InputHandleTable[(uint8)InputData.InputID] = InputData.AbilitySpecHandle;
+			SpecHandleInputMap.Add(InputData.AbilitySpecHandle, InputData.InputID);
+		}
+	}
+
+	MarkInputBindingsChanged();
 }
 
 TSet<ERPGInventorySlot> URPGInventoryComponent::GetCompatibleSlotsByItem(ARPGInventoryItemBase* Item)
@@ -63,11 +173,47 @@ TSet<ERPGInventorySlot> URPGInventoryComponent::GetCompatibleSlotsByItem(ARPGInv
 	
 }
 
-void URPGInventoryComponent::OnRep_Inventory()
+void URPGInventoryComponent::OnSlottedItemAdded(const FRPGInventorySlotData& SlotData)
+{
+	SetSlotTableItem(SlotData.Slot, SlotData.ItemActor);
+}
+
+void URPGInventoryComponent::OnSlottedItemChanged(const FRPGInventorySlotData& SlotData)
 {
+	SetSlotTableItem(SlotData.Slot, SlotData.ItemActor);
+}
+
+void URPGInventoryComponent::OnSlottedItemRemoved(const FRPGInventorySlotData& SlotData)
+{
+	//only clear the slot if it wasn't already replaced by an add in the same update
+	if (GetSlotInventoryItem(SlotData.Slot) == SlotData.ItemActor)
+	{
+		SetSlotTableItem(SlotData.Slot, nullptr);
+	}
+
 	//#TODO call swap weapons or get the best next weapon, since the inventory might have dropped or swapped our current weapon
 }
 
+void URPGInventoryComponent::OnLooseItemAdded(const FRPGLooseInventoryData& LooseData)
+{
+
+}
+
+void URPGInventoryComponent::OnLooseItemChanged(const FRPGLooseInventoryData& LooseData)
+{
+
+}
+
+void URPGInventoryComponent::OnLooseItemRemoved(const FRPGLooseInventoryData& LooseData)
+{
+
+}
+
+void URPGInventoryComponent::OnRep_AbilityInputHandles()
+{
+	RebuildInputHandleTables();
+}
+
 void URPGInventoryComponent::OnRep_CurrentWeapon(ARPGInventoryItemBase* LastWeapon)
 {
 	SetCurrentWeapon(CurrentWeapon, LastWeapon);
@@ -99,9 +245,13 @@ void URPGInventoryComponent::BindAbilityToInput(ERPGAbilityInputID InputID, TSub
 	if (AbilityToAcquire)
 	{
 		FGameplayAbilitySpecHandle NewAbilitySpecHandle = AcquireAbility(AbilityToAcquire, SourceObject);
-		if (NewAbilitySpecHandle.IsValid())
+		if (NewAbilitySpecHandle.IsValid() && InputID < ERPGAbilityInputID::MAX)
 		{
 			AbilityInputHandles.Add(FRPGAbilityInputHandleData(InputID, NewAbilitySpecHandle));
+			MARK_PROPERTY_DIRTY_FROM_NAME(URPGInventoryComponent, AbilityInputHandles, this);
+			InputHandleTable[(uint8)InputID] = NewAbilitySpecHandle;
+			SpecHandleInputMap.Add(NewAbilitySpecHandle, InputID);
+			MarkInputBindingsChanged();
 		}
 	}
 }
@@ -121,19 +271,28 @@ FGameplayAbilitySpecHandle URPGInventoryComponent::AcquireAbility(TSubclassOf<UG
 void URPGInventoryComponent::UnbindAbilityFromInput(ERPGAbilityInputID InputID)
 {
 	//need to do a check again here since both RemoveItemFromSlot and AddAbilityToSlot calls this to clear any existing abilities in the slot
-	FRPGAbilityInputHandleData* FoundInputData = AbilityInputHandles.FindByKey(InputID);
+	if (InputID >= ERPGAbilityInputID::MAX)
+	{
+		return;
+	}
+
+	const FGameplayAbilitySpecHandle FoundHandle = InputHandleTable[(uint8)InputID];
 
-	if (FoundInputData)
+	if (FoundHandle.IsValid())
 	{
 		//remove the ability previous ability, it maybe that the player pawn is dead and if we have the inventory component on the player state, then the component will be destroyed when the player dies
 		//so it might not exist at this point so we don't even have to remove the component
 		if (GetAbilitySystemComponent())
 		{
-			GetAbilitySystemComponent()->ClearAbility(FoundInputData->AbilitySpecHandle);
+			GetAbilitySystemComponent()->ClearAbility(FoundHandle);
 		}
 
 		//remove the index, just much easier than modifying the data depending on if we found it or not
-		AbilityInputHandles.Remove(*FoundInputData); //#TODO use RemoveAll, currently using a pointer to the data to we are about to remove, might cause issues if we have to remove multiple
+		AbilityInputHandles.RemoveAllSwap([InputID](const FRPGAbilityInputHandleData& InputData) { return InputData.InputID == InputID; });
+		MARK_PROPERTY_DIRTY_FROM_NAME(URPGInventoryComponent, AbilityInputHandles, this);
+		InputHandleTable[(uint8)InputID] = FGameplayAbilitySpecHandle();
+		SpecHandleInputMap.Remove(FoundHandle);
+		MarkInputBindingsChanged();
 	}
 }
 
@@ -165,14 +324,6 @@ void URPGInventoryComponent::BeginPlay()
 
 }
 
-// Called every frame
-void URPGInventoryComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
-{
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-
-	// ...
-}
-
 bool URPGInventoryComponent::AddItem(ARPGInventoryItemBase* Item, ERPGInventorySlot Slot /*= ERPGInventorySlot::None*/)
 {
 	if (!GetOwner()->HasAuthority() || !Item || Item->ItemType > ERPGItemType::PassiveItem && Slot == ERPGInventorySlot::None)
@@ -193,7 +344,10 @@ bool URPGInventoryComponent::AddItem(ARPGInventoryItemBase* Item, ERPGInventoryS
 			return false;
 		}
 
-		SlottedInventory.Add(FRPGInventorySlotData(Slot, Item)); //add the item to the inventory
+		FRPGInventorySlotData& NewSlotData = SlottedInventory.Items.Add_GetRef(FRPGInventorySlotData(Slot, Item)); //add the item to the inventory
+		SlottedInventory.MarkItemDirty(NewSlotData);
+		MARK_PROPERTY_DIRTY_FROM_NAME(URPGInventoryComponent, SlottedInventory, this);
+		SetSlotTableItem(Slot, Item);
 		Item->OnEnterInventory(GetOwner());
 
 		//ideally if we have 2 weapons and we are picking up one then we should have called remove item from slot at which point the ActiveWeapon slot would be set to the other weapon slot
@@ -230,11 +384,13 @@ ARPGInventoryItemBase* URPGInventoryComponent::RemoveItemFromSlot(ERPGInventoryS
 	}
 
 	ARPGInventoryItemBase* FoundItem = nullptr;
-	const FRPGInventorySlotData* FoundSlotData = SlottedInventory.FindByKey(Slot);
-	if (FoundSlotData)
+	FoundItem = GetSlotInventoryItem(Slot);
+	if (FoundItem)
 	{
-		FoundItem = FoundSlotData->ItemActor;
-		SlottedInventory.Remove(*FoundSlotData); //#TODO use RemoveAll, currently using a pointer to the data to we are about to remove, might cause issues if we have to remove multiple
+		SlottedInventory.Items.RemoveAllSwap([Slot](const FRPGInventorySlotData& SlotData) { return SlotData.Slot == Slot; }); //order doesn't matter, the slot is stored in the data
+		SlottedInventory.MarkArrayDirty();
+		MARK_PROPERTY_DIRTY_FROM_NAME(URPGInventoryComponent, SlottedInventory, this);
+		SetSlotTableItem(Slot, nullptr);
 	}
 
 
@@ -245,13 +401,24 @@ ARPGInventoryItemBase* URPGInventoryComponent::RemoveItemFromSlot(ERPGInventoryS
 	return FoundItem;
 }
 
-ARPGInventoryItemBase* URPGInventoryComponent::GetSlotInventoryItem(ERPGInventorySlot Slot) const
+TArray<ARPGInventoryItemBase*> URPGInventoryComponent::GetLooseInventory() const
 {
-	const FRPGInventorySlotData* FoundSlotData = SlottedInventory.FindByKey(Slot);
+	TArray<ARPGInventoryItemBase*> LooseItems;
+	LooseItems.Reserve(LooseInventory.Items.Num());
+
+	for (const FRPGLooseInventoryData& LooseData : LooseInventory.Items)
+	{
+		LooseItems.Add(LooseData.ItemActor);
+	}
+
+	return LooseItems;
+}
 
-	if (FoundSlotData)
+ARPGInventoryItemBase* URPGInventoryComponent::GetSlotInventoryItem(ERPGInventorySlot Slot) const
+{
+	if (Slot < ERPGInventorySlot::MAX)
 	{
-		return FoundSlotData->ItemActor;
+		return SlotItemTable[(uint8)Slot];
 	}
 
 	return nullptr;
@@ -259,11 +426,11 @@ ARPGInventoryItemBase* URPGInventoryComponent::GetSlotInventoryItem(ERPGInventor
 
 ERPGAbilityInputID URPGInventoryComponent::GetAbilityHandleInputID(const FGameplayAbilitySpecHandle& AbilitySpecHandle) const
 {
-	const FRPGAbilityInputHandleData* const FoundInputData = AbilityInputHandles.FindByKey(AbilitySpecHandle);
+	const ERPGAbilityInputID* const FoundInputID = SpecHandleInputMap.Find(AbilitySpecHandle);
 
-	if (FoundInputData)
+	if (FoundInputID)
 	{
-		return FoundInputData->InputID;
+		return *FoundInputID;
 	}
 
 	return ERPGAbilityInputID::None;
@@ -283,13 +450,13 @@ FGameplayTagContainer URPGInventoryComponent::GetAbilityInputCooldownTag(const E
 
 bool URPGInventoryComponent::ActivateAbilitiesWithInputID(ERPGAbilityInputID InputID, bool bAllowRemoteActivation /*= true*/)
 {
-	//Find returns a pointer, so make sure to dereference it
-	FRPGAbilityInputHandleData* FoundInputData = AbilityInputHandles.FindByKey(InputID);
+	const FGameplayAbilitySpecHandle FoundHandle = (InputID < ERPGAbilityInputID::MAX) ? InputHandleTable[(uint8)InputID] : FGameplayAbilitySpecHandle();
 
-	//make sure the slot data is found and the ability spec handle is valid
-	if (GetAbilitySystemComponent() && FoundInputData && FoundInputData->AbilitySpecHandle.IsValid())
+	//make sure the ability system is found and the ability spec handle is valid
+	UAbilitySystemComponent* AbilitySystem = GetAbilitySystemComponent();
+	if (AbilitySystem && FoundHandle.IsValid())
 	{
-		return GetAbilitySystemComponent()->TryActivateAbility(FoundInputData->AbilitySpecHandle, bAllowRemoteActivation);
+		return AbilitySystem->TryActivateAbility(FoundHandle, bAllowRemoteActivation);
 	}
 	else
 	{
@@ -340,6 +507,8 @@ void URPGInventoryComponent::SetCurrentWeapon(ARPGInventoryItemBase* NewWeapon,
 	}
 
 	CurrentWeapon = NewWeapon;
+	MARK_PROPERTY_DIRTY_FROM_NAME(URPGInventoryComponent, CurrentWeapon, this);
+	MarkInputBindingsChanged();
 
 	// equip new one
 	if (NewWeapon)
@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/RPGSignificanceSubsystem.h"
+#include "Character/RPGCharacterBase.h"
+#include "Character/RPGAnimInstanceBase.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "SignificanceManager.h"
+#include "Engine/World.h"
+
+const FName URPGSignificanceSubsystem::CharacterTag(TEXT("RPGCharacter"));
+
+URPGSignificanceSubsystem::URPGSignificanceSubsystem()
+{
+	HighSignificanceDistance = 1500.0f;
+	MediumSignificanceDistance = 4000.0f;
+	RenderedTolerance = 0.5f;
+	MediumAnimFrameSkip = 1;
+	LowAnimFrameSkip = 3;
+}
+
+bool URPGSignificanceSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void URPGSignificanceSubsystem::RegisterCharacter(ARPGCharacterBase* Character)
+{
+	USignificanceManager* SignificanceManager = USignificanceManager::Get(GetWorld());
+	if (!SignificanceManager || !Character)
+	{
+		return;
+	}
+
+	auto SignificanceFunction = [this](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint) -> float
+	{
+		return CalculateSignificance(CastChecked<ARPGCharacterBase>(ObjectInfo->GetObject()), Viewpoint);
+	};
+
+	auto PostSignificanceFunction = [this](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float Significance, bool bFinal)
+	{
+		if (bFinal || OldSignificance != Significance)
+		{
+			ApplySignificance(CastChecked<ARPGCharacterBase>(ObjectInfo->GetObject()), (ERPGSignificance)FMath::RoundToInt(Significance), bFinal);
+		}
+	};
+
+	SignificanceManager->RegisterObject(Character, CharacterTag, SignificanceFunction, USignificanceManager::EPostSignificanceType::Sequential, PostSignificanceFunction);
+}
+
+void URPGSignificanceSubsystem::UnregisterCharacter(ARPGCharacterBase* Character)
+{
+	if (USignificanceManager* SignificanceManager = USignificanceManager::Get(GetWorld()))
+	{
+		SignificanceManager->UnregisterObject(Character);
+	}
+}
+
+float URPGSignificanceSubsystem::CalculateSignificance(const ARPGCharacterBase* Character, const FTransform& Viewpoint) const
+{
+	if (Character->IsLocallyControlled())
+	{
+		return (float)ERPGSignificance::High;
+	}
+
+	const USkeletalMeshComponent* Mesh = Character->GetMesh();
+	if (!Mesh || !Mesh->WasRecentlyRendered(RenderedTolerance))
+	{
+		return (float)ERPGSignificance::Hidden;
+	}
+
+	const float DistanceSquared = FVector::DistSquared(Character->GetActorLocation(), Viewpoint.GetLocation());
+	if (DistanceSquared < FMath::Square(HighSignificanceDistance))
+	{
+		return (float)ERPGSignificance::High;
+	}
+
+	if (DistanceSquared < FMath::Square(MediumSignificanceDistance))
+	{
+		return (float)ERPGSignificance::Medium;
+	}
+
+	return (float)ERPGSignificance::Low;
+}
+
+void URPGSignificanceSubsystem::ApplySignificance(ARPGCharacterBase* Character, ERPGSignificance Significance, bool bFinal) const
+{
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	if (!Mesh)
+	{
+		return;
+	}
+
+	//back to full rate when unregistered
+	if (bFinal)
+	{
+		Significance = ERPGSignificance::High;
+	}
+
+	//hidden characters only tick their montages on clients, the server still needs the pose for the melee sweeps
+	if (Character->GetNetMode() == NM_Client)
+	{
+		const ARPGCharacterBase* CDO = Character->GetClass()->GetDefaultObject<ARPGCharacterBase>();
+		const EVisibilityBasedAnimTickOption DefaultTickOption = CDO->GetMesh() ? CDO->GetMesh()->VisibilityBasedAnimTickOption : Mesh->VisibilityBasedAnimTickOption;
+
+		Mesh->VisibilityBasedAnimTickOption = Significance == ERPGSignificance::Hidden ? EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered : DefaultTickOption;
+	}
+
+	ApplyUpdateRateParams(Mesh, Significance, bFinal);
+
+	if (URPGAnimInstanceBase* AnimInstance = Cast<URPGAnimInstanceBase>(Mesh->GetAnimInstance()))
+	{
+		AnimInstance->SetSignificance(Significance);
+	}
+}
+
+void URPGSignificanceSubsystem::ApplyUpdateRateParams(USkeletalMeshComponent* Mesh, ERPGSignificance Significance, bool bFinal) const
+{
+	//created when the mesh is registered with bEnableUpdateRateOptimizations, shared by all the meshes of the actor
+	FAnimUpdateRateParameters* UpdateRateParams = Mesh->AnimUpdateRateParams;
+	if (!UpdateRateParams)
+	{
+		return;
+	}
+
+	//back to the screen size based rates
+	if (bFinal)
+	{
+		UpdateRateParams->bShouldUseLodMap = false;
+		UpdateRateParams->LODToFrameSkipMap.Reset();
+		return;
+	}
+
+	//hidden characters take the not rendered path of the URO, which doesn't use the map
+	int32 FrameSkip = 0;
+	switch (Significance)
+	{
+	case ERPGSignificance::Medium:
+		FrameSkip = MediumAnimFrameSkip;
+		break;
+	case ERPGSignificance::Low:
+	case ERPGSignificance::Hidden:
+		FrameSkip = LowAnimFrameSkip;
+		break;
+	default:
+		break;
+	}
+
+	UpdateRateParams->bShouldUseLodMap = true;
+	UpdateRateParams->LODToFrameSkipMap.Reset();
+	for (int32 LODIndex = 0; LODIndex < FMath::Max(Mesh->GetNumLODs(), 1); LODIndex++)
+	{
+		UpdateRateParams->LODToFrameSkipMap.Add(LODIndex, FMath::Max(FrameSkip, 0));
+	}
+}
+
+void URPGSignificanceSubsystem::Tick(float DeltaTime)
+{
+	USignificanceManager* SignificanceManager = USignificanceManager::Get(GetWorld());
+	if (!SignificanceManager)
+	{
+		return;
+	}
+
+	Viewpoints.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PC = Iterator->Get();
+		if (PC && PC->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+			Viewpoints.Add(FTransform(ViewRotation, ViewLocation));
+		}
+	}
+
+	SignificanceManager->Update(Viewpoints);
+}
+
+bool URPGSignificanceSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->IsGameWorld() && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId URPGSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URPGSignificanceSubsystem, STATGROUP_Tickables);
+}
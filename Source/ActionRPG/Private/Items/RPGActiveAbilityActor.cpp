@@ -11,8 +11,8 @@ DEFINE_LOG_CATEGORY(LogAbilityActor);
 ARPGActiveAbilityActor::ARPGActiveAbilityActor(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	//dropped items are spun by URPGDroppedItemSpinnerSubsystem, nothing to tick
+	PrimaryActorTick.bCanEverTick = false;
 
 	ItemType = ERPGItemType::ActiveItem;
 }
@@ -24,9 +24,3 @@ void ARPGActiveAbilityActor::BeginPlay()
 	
 }
 
-// Called every frame
-void ARPGActiveAbilityActor::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-}
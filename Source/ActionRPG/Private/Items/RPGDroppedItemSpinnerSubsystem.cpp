@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Items/RPGDroppedItemSpinnerSubsystem.h"
+#include "Items/RPGInventoryItemBase.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("RPGDroppedItemSpinner: spin"), STAT_RPGDroppedItemSpinner_Spin, STATGROUP_Game);
+
+URPGDroppedItemSpinnerSubsystem::URPGDroppedItemSpinnerSubsystem()
+{
+	SpinDegreesPerSecond = 360.0f;
+	RenderedTolerance = 0.2f;
+	SpinAngle = 0.0f;
+}
+
+void URPGDroppedItemSpinnerSubsystem::AddItem(ARPGInventoryItemBase* Item, USceneComponent* Turntable, UPrimitiveComponent* VisibilityComponent)
+{
+	if (!Item || !Turntable || ItemIndices.Contains(Item))
+	{
+		return;
+	}
+
+	FSpinningItem SpinningItem;
+	SpinningItem.Item = Item;
+	SpinningItem.ItemKey = Item;
+	SpinningItem.Turntable = Turntable;
+	SpinningItem.VisibilityComponent = VisibilityComponent;
+	SpinningItem.BaseLocation = Turntable->GetRelativeLocation();
+	SpinningItem.BaseRotation = Turntable->GetRelativeRotation().Quaternion();
+
+	ItemIndices.Add(Item, Items.Add(SpinningItem));
+}
+
+void URPGDroppedItemSpinnerSubsystem::RemoveItem(ARPGInventoryItemBase* Item)
+{
+	if (const int32* Index = ItemIndices.Find(Item))
+	{
+		RemoveAt(*Index);
+	}
+}
+
+void URPGDroppedItemSpinnerSubsystem::RemoveAt(int32 Index)
+{
+	FSpinningItem& SpinningItem = Items[Index];
+
+	//put the turntable back so the next drop starts from the same base
+	if (USceneComponent* Turntable = SpinningItem.Turntable.Get())
+	{
+		Turntable->SetRelativeLocationAndRotation(SpinningItem.BaseLocation, SpinningItem.BaseRotation);
+	}
+
+	ItemIndices.Remove(SpinningItem.ItemKey);
+
+	Items.RemoveAtSwap(Index, 1, false);
+	if (Items.IsValidIndex(Index))
+	{
+		ItemIndices.Add(Items[Index].ItemKey, Index);
+	}
+}
+
+void URPGDroppedItemSpinnerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RPGDroppedItemSpinner_Spin);
+
+	SpinAngle = FMath::Fmod(SpinAngle + SpinDegreesPerSecond * DeltaTime, 360.0f);
+	const FQuat SpinRotation(FVector::UpVector, FMath::DegreesToRadians(SpinAngle));
+
+	for (int32 Index = Items.Num() - 1; Index >= 0; Index--)
+	{
+		FSpinningItem& SpinningItem = Items[Index];
+
+		USceneComponent* Turntable = SpinningItem.Turntable.Get();
+		if (!Turntable || !SpinningItem.Item.IsValid())
+		{
+			//destroyed without being removed, the moved item was already updated since we are going backwards
+			RemoveAt(Index);
+			continue;
+		}
+
+		const UPrimitiveComponent* VisibilityComponent = SpinningItem.VisibilityComponent.Get();
+		if (VisibilityComponent && !VisibilityComponent->WasRecentlyRendered(RenderedTolerance))
+		{
+			continue;
+		}
+
+		//same as spinning the whole actor around the root, without moving the interactive collision
+		Turntable->SetRelativeLocationAndRotation(SpinRotation.RotateVector(SpinningItem.BaseLocation), SpinRotation * SpinningItem.BaseRotation);
+	}
+}
+
+bool URPGDroppedItemSpinnerSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return Items.Num() > 0 && World && World->IsGameWorld() && World->GetNetMode() != NM_DedicatedServer && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId URPGDroppedItemSpinnerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URPGDroppedItemSpinnerSubsystem, STATGROUP_Tickables);
+}
@@ -2,19 +2,27 @@
 
 
 #include "Items/RPGInventoryItemBase.h"
+#include "Items/RPGDroppedItemSpinnerSubsystem.h"
 #include "Character/RPGCharacterBase.h"
 #include "Components/SphereComponent.h"
 #include "Net/UnrealNetwork.h"
 
+FRPGOnItemOwnerChanged ARPGInventoryItemBase::OnItemOwnerChanged;
+FRPGOnItemEquipChanged ARPGInventoryItemBase::OnItemEquipChanged;
+
 // Sets default values
 ARPGInventoryItemBase::ARPGInventoryItemBase(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	//the dropped item turntable is spun by URPGDroppedItemSpinnerSubsystem, the items don't tick
+	PrimaryActorTick.bCanEverTick = false;
 	SetReplicates(true);
 	SetReplicateMovement(false);
 
+	//nothing about an item changes while it's on the ground or in an inventory, it's woken with FlushNetDormancy when picked up, dropped or equipped
+	//placed items are never sent until they're woken, spawned items go dormant after they are sent once (BeginPlay)
+	NetDormancy = DORM_Initial;
+
 	//need a empty scene component for the root since it will make the mesh the root otherwise
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
 
@@ -36,6 +44,9 @@ ARPGInventoryItemBase::ARPGInventoryItemBase(const FObjectInitializer& ObjectIni
 
 	ItemType = ERPGItemType::None;
 	bIsEquipped = false;
+
+	OwnerChangeRelevancyTime = 1.0f;
+	LastOwnerChangeTime = -BIG_NUMBER;
 }
 
 void ARPGInventoryItemBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -45,6 +56,50 @@ void ARPGInventoryItemBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>
 	//DOREPLIFETIME(ARPGInventoryItemBase, AvatarCharacter);
 }
 
+void ARPGInventoryItemBase::SetOwner(AActor* NewOwner)
+{
+	AActor* OldOwner = GetOwner();
+
+	if (OldOwner != NewOwner)
+	{
+		FlushNetDormancy();
+
+		if (HasAuthority() && GetWorld())
+		{
+			LastOwnerChangeTime = GetWorld()->GetTimeSeconds();
+		}
+	}
+
+	Super::SetOwner(NewOwner);
+
+	if (OldOwner != NewOwner && HasAuthority())
+	{
+		OnItemOwnerChanged.Broadcast(this, OldOwner);
+	}
+}
+
+bool ARPGInventoryItemBase::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (bIsEquipped && AvatarCharacter)
+	{
+		return AvatarCharacter->IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+	}
+
+	if (GetOwner() && !IsOwnerChangePending())
+	{
+		return IsOwnedBy(RealViewer) || IsOwnedBy(ViewTarget);
+	}
+
+	//on the ground, or just picked up and the non owners that could see it still need the new owner
+	return IsOwnedBy(RealViewer) || IsOwnedBy(ViewTarget) || Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
+bool ARPGInventoryItemBase::IsOwnerChangePending() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->TimeSince(LastOwnerChangeTime) < OwnerChangeRelevancyTime;
+}
+
 void ARPGInventoryItemBase::OnEnterInventory(class AActor* NewOwner, class ARPGCharacterBase* NewAvatarCharacter /*= nullptr*/)
 {
 	SetOwner(NewOwner);
@@ -70,9 +125,13 @@ void ARPGInventoryItemBase::OnLeaveInventory()
 	SetInstigator(nullptr);
 	AvatarCharacter = nullptr;
 
+	if (bIsEquipped && HasAuthority())
+	{
+		OnItemEquipChanged.Broadcast(this, nullptr);
+	}
 	bIsEquipped = false;
 
-	SetActorTickEnabled(true);
+	SetTurntableSpinning(true);
 	Mesh->SetHiddenInGame(false);
 	Mesh->AttachToComponent(TurntableAttachOffset, FAttachmentTransformRules::SnapToTargetNotIncludingScale);
 	InteractiveCollision->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
@@ -86,11 +145,19 @@ void ARPGInventoryItemBase::OnEquip(class ARPGCharacterBase* NewAvatarCharacter,
 		SetOwner(NewOwner);
 	}
 
+	FlushNetDormancy();
+
 	SetInstigator(AvatarCharacter);
 	AvatarCharacter = NewAvatarCharacter;
 
 	bIsEquipped = true;
 	AttachMeshToPawn();
+
+	if (HasAuthority())
+	{
+		OnItemEquipChanged.Broadcast(this, AvatarCharacter);
+	}
+
 	OnEquipFinished(NewAvatarCharacter);	//#TODO equip anim or particle effect
 }
 
@@ -105,10 +172,16 @@ void ARPGInventoryItemBase::OnUnEquip()
 	//so we don't want to hide it if it's visible on the ground
 	if (bIsEquipped)
 	{
+		FlushNetDormancy();
 		DetachMeshFromPawn();
 
 		AvatarCharacter = nullptr;
 		bIsEquipped = false;
+
+		if (HasAuthority())
+		{
+			OnItemEquipChanged.Broadcast(this, nullptr);
+		}
 	}
 }
 
@@ -116,6 +189,44 @@ void ARPGInventoryItemBase::OnUnEquip()
 void ARPGInventoryItemBase::BeginPlay()
 {
 	Super::BeginPlay();
+
+	//placed in the level or spawned on the ground
+	if (!GetOwner())
+	{
+		SetTurntableSpinning(true);
+	}
+
+	//DORM_Initial only keeps the placed items from being sent, the spawned ones still have to be sent once
+	if (HasAuthority() && !IsNetStartupActor())
+	{
+		SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+void ARPGInventoryItemBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	SetTurntableSpinning(false);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ARPGInventoryItemBase::SetTurntableSpinning(bool bSpinning)
+{
+	UWorld* World = GetWorld();
+	URPGDroppedItemSpinnerSubsystem* Spinner = World ? World->GetSubsystem<URPGDroppedItemSpinnerSubsystem>() : nullptr;
+	if (!Spinner)
+	{
+		return;
+	}
+
+	if (bSpinning)
+	{
+		Spinner->AddItem(this, TurntableAttachOffset, Mesh);
+	}
+	else
+	{
+		Spinner->RemoveItem(this);
+	}
 }
 
 void ARPGInventoryItemBase::OnRep_Owner()
@@ -151,28 +262,14 @@ void ARPGInventoryItemBase::AttachMeshToPawn()
 
 void ARPGInventoryItemBase::DetachMeshFromPawn()
 {
+	//held items stay where they were picked up, only the owner can see them (IsNetRelevantFor) so the location doesn't matter for relevancy
 	DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
-	SetActorLocation(FVector(0.0f)); //#TODO does it stop replicating if out of range??
 
-	SetActorTickEnabled(false);
+	SetTurntableSpinning(false);
 	Mesh->SetHiddenInGame(true);
 	InteractiveCollision->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 }
 
-// Called every frame
-void ARPGInventoryItemBase::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-	//if not attached to something then we assume that the item is dropped
-	if (!GetOwner())
-	{
-		FRotator ActorRotation = GetActorRotation();
-		ActorRotation.Yaw += 360.0f * DeltaTime;
-		SetActorRotation(ActorRotation);
-	}
-}
-
 /*
 void ARPGInventoryItemBase::GiveTo(class AActor* NewOwner, class ACharacter* NewAvatarCharacter / *= nullptr* /)
 {
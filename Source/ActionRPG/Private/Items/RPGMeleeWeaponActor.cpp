@@ -7,30 +7,33 @@
 #include "Components/PrimitiveComponent.h"
 #include "AbilitySystemBlueprintLibrary.h"
 #include "Character/RPGCharacterBase.h"
+#include "RPGGameplayTags.h"
+#include "Engine/World.h"
 
 
+DECLARE_CYCLE_STAT(TEXT("RPGMeleeWeapon: sweep"), STAT_RPGMeleeWeapon_Sweep, STATGROUP_Game);
+
 // Sets default values
 ARPGMeleeWeaponActor::ARPGMeleeWeaponActor(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
+	//only ticks while the attack window is open, after the animation has updated the weapon socket
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
 
 	CollisionComponent = CreateDefaultSubobject<UCapsuleComponent>("Collision");
 	CollisionComponent->SetupAttachment(GetMesh()); //attach to root so that mesh scaling doesn't effect the collision, scale the whole actor if you need to do that
 	CollisionComponent->SetCapsuleSize(15.0f, 40.0f, false);
 	CollisionComponent->SetRelativeLocation(FVector(0.0f, 0.0f, 40.0f));
 	CollisionComponent->SetCollisionProfileName(TEXT("OverlapOnlyPawn"));
-	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision); //disable collision by default
-}
+	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision); //only used as the sweep shape
+	CollisionComponent->SetGenerateOverlapEvents(false);
 
-void ARPGMeleeWeaponActor::PostInitializeComponents()
-{
-	Super::PostInitializeComponents();
+	SweepProfileName = TEXT("OverlapOnlyPawn");
+	MaxSweepSubsteps = 8;
 
-	//just make sure we don't get any problems with the blueprints
-	//this will crash if you had in the constructor and moved it, will need to reparent the blueprint classes
-	CollisionComponent->OnComponentBeginOverlap.AddDynamic(this, &ARPGMeleeWeaponActor::OnBeginOverlap);
+	bAttacking = false;
 }
 
 // Called when the game starts or when spawned
@@ -43,37 +46,129 @@ void ARPGMeleeWeaponActor::BeginPlay()
 void ARPGMeleeWeaponActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-}
 
+	if (bAttacking)
+	{
+		SweepWeapon();
+		SendPendingHits();
+	}
+}
 
 void ARPGMeleeWeaponActor::BeginAttack()
 {
-	IgnoredActors.Empty();
+	IgnoredActors.Reset();
+	PendingHits.Reset();
+
+	//hits are only detected on the server
+	if (!GetOwner() || !GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	bAttacking = true;
+	LastSweepTransform = CollisionComponent->GetComponentTransform();
+
+	//overlap at the start position so something already touching the weapon gets hit
+	SweepWeapon();
+	SetActorTickEnabled(true);
 
-	ECollisionEnabled::Type CollisionEnabled = GetOwner()->HasAuthority() ? ECollisionEnabled::QueryOnly : ECollisionEnabled::NoCollision;
-	CollisionComponent->SetCollisionEnabled(CollisionEnabled);	//query only since that enables overlaps, doesn't need physics
+	SendPendingHits();
 }
 
 void ARPGMeleeWeaponActor::EndAttack()
 {
-	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	if (!bAttacking)
+	{
+		return;
+	}
+
+	//catch the path since the last tick
+	SweepWeapon();
+
+	bAttacking = false;
+	SetActorTickEnabled(false);
+
+	SendPendingHits();
 }
 
-void ARPGMeleeWeaponActor::OnBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void ARPGMeleeWeaponActor::SweepWeapon()
 {
-	//even though we ignore our actor, our actor does not 
-	if (AvatarCharacter == OtherActor || IgnoredActors.Contains(OtherActor))
+	SCOPE_CYCLE_COUNTER(STAT_RPGMeleeWeapon_Sweep);
+
+	UWorld* World = GetWorld();
+	if (!World)
 	{
 		return;
 	}
 
-	IgnoredActors.Add(OtherActor); //ignore the actor so we won't hit them twice in the same attack
-	
-	FGameplayTag EventTag(FGameplayTag::RequestGameplayTag(FName("Event.Hit.Melee"))); //#TODO weapon actor specific tags?
-	FGameplayEventData Payload;
-	Payload.Instigator = this;
-	Payload.Target = OtherActor;
+	const FTransform CurrentTransform = CollisionComponent->GetComponentTransform();
+	const float Radius = CollisionComponent->GetScaledCapsuleRadius();
+	const float HalfHeight = CollisionComponent->GetScaledCapsuleHalfHeight();
 
-	//we assume that the player's ability system component is on the AvatarCharacter
-	UAbilitySystemBlueprintLibrary::SendGameplayEventToActor(AvatarCharacter, EventTag, Payload); //use the blueprint library
-}
\ No newline at end of file
+	//split the path so that neither end of the capsule moves more than the radius per step, the weapon swings in an arc so the tip moves the most
+	const FVector LastAxis = LastSweepTransform.GetRotation().GetUpVector() * HalfHeight;
+	const FVector CurrentAxis = CurrentTransform.GetRotation().GetUpVector() * HalfHeight;
+	const float MaxEndMove = FMath::Max(FVector::Dist(LastSweepTransform.GetLocation() + LastAxis, CurrentTransform.GetLocation() + CurrentAxis),
+		FVector::Dist(LastSweepTransform.GetLocation() - LastAxis, CurrentTransform.GetLocation() - CurrentAxis));
+	const int32 NumSteps = FMath::Clamp(FMath::CeilToInt(MaxEndMove / FMath::Max(Radius, 1.0f)), 1, MaxSweepSubsteps);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(RPGMeleeWeaponSweep), false, this);
+	if (AvatarCharacter)
+	{
+		Params.AddIgnoredActor(AvatarCharacter);
+	}
+
+	const FCollisionShape Shape = FCollisionShape::MakeCapsule(Radius, HalfHeight);
+
+	FVector StepStart = LastSweepTransform.GetLocation();
+	for (int32 Step = 1; Step <= NumSteps; Step++)
+	{
+		const float Alpha = (float)Step / (float)NumSteps;
+		const FVector StepEnd = FMath::Lerp(LastSweepTransform.GetLocation(), CurrentTransform.GetLocation(), Alpha);
+		const FQuat StepRotation = FQuat::Slerp(LastSweepTransform.GetRotation(), CurrentTransform.GetRotation(), Alpha);
+
+		SweepHits.Reset();
+		World->SweepMultiByProfile(SweepHits, StepStart, StepEnd, StepRotation, SweepProfileName, Shape, Params);
+
+		for (const FHitResult& Hit : SweepHits)
+		{
+			AActor* HitActor = Hit.GetActor();
+			if (!HitActor || HitActor == AvatarCharacter || IgnoredActors.Contains(HitActor))
+			{
+				continue;
+			}
+
+			IgnoredActors.Add(HitActor); //ignore the actor so we won't hit them twice in the same attack
+			PendingHits.Add(Hit);
+		}
+
+		StepStart = StepEnd;
+	}
+
+	LastSweepTransform = CurrentTransform;
+}
+
+void ARPGMeleeWeaponActor::SendPendingHits()
+{
+	if (PendingHits.Num() == 0)
+	{
+		return;
+	}
+
+	//the events can begin or end the attack which touches PendingHits
+	TArray<FHitResult> Hits = MoveTemp(PendingHits);
+	PendingHits.Reset();
+
+	const FGameplayTag& EventTag = FRPGGameplayTags::Event_Hit_Melee; //#TODO weapon actor specific tags?
+	for (const FHitResult& Hit : Hits)
+	{
+		//one event per hit actor, same as the overlap events sent before, the hit result is in the target data for anything that needs it
+		FGameplayEventData Payload;
+		Payload.Instigator = this;
+		Payload.Target = Hit.GetActor();
+		Payload.TargetData.Add(new FGameplayAbilityTargetData_SingleTargetHit(Hit));
+
+		//we assume that the player's ability system component is on the AvatarCharacter
+		UAbilitySystemBlueprintLibrary::SendGameplayEventToActor(AvatarCharacter, EventTag, Payload); //use the blueprint library
+	}
+}
@@ -0,0 +1,411 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RPGBenchmarkSubsystem.h"
+#include "Character/RPGCharacterBase.h"
+#include "AI/RPGAIController.h"
+#include "AI/RPGBenchmarkBotController.h"
+#include "BlueprintLibrary/RPGAIBlueprintHelperLibrary.h"
+#include "Abilities/GameplayAbility.h"
+#include "AbilitySystemComponent.h"
+#include "GameFramework/PlayerStart.h"
+#include "NavigationSystem.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "HAL/IConsoleManager.h"
+
+CSV_DEFINE_CATEGORY(RPGBenchmark, true);
+
+static void RPGBenchmarkCommand(const TArray<FString>& Args, UWorld* World)
+{
+	URPGBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<URPGBenchmarkSubsystem>() : nullptr;
+	if (!Benchmark)
+	{
+		return;
+	}
+
+	//the command line still picks the classes, the args only override the counts
+	FRPGBenchmarkSettings Settings = FRPGBenchmarkSettings::FromCommandLine();
+	if (Args.Num() > 0)
+	{
+		Settings.NumAI = FCString::Atoi(*Args[0]);
+	}
+	if (Args.Num() > 1)
+	{
+		Settings.Duration = FCString::Atof(*Args[1]);
+	}
+	Settings.bQuitWhenDone = false;
+
+	if (!Benchmark->StartBenchmark(Settings))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("rpg.Benchmark: couldn't start, already running, not the server or no AI class (-RPGBenchmarkAIClass=)"));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs RPGBenchmarkConsoleCommand(
+	TEXT("rpg.Benchmark"),
+	TEXT("Spawn AI and bots and measure the frame times, rpg.Benchmark [NumAI] [Duration], see URPGBenchmarkSubsystem"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RPGBenchmarkCommand));
+
+FRPGBenchmarkSettings::FRPGBenchmarkSettings()
+	: NumAI(100), NumBots(4), WarmupTime(5.0f), Duration(60.0f), SpawnRadius(3000.0f), Name(TEXT("RPGBenchmark")), bQuitWhenDone(false)
+{
+
+}
+
+FRPGBenchmarkSettings FRPGBenchmarkSettings::FromCommandLine()
+{
+	FRPGBenchmarkSettings Settings;
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("RPGBenchmarkAI="), Settings.NumAI);
+	FParse::Value(CommandLine, TEXT("RPGBenchmarkBots="), Settings.NumBots);
+	FParse::Value(CommandLine, TEXT("RPGBenchmarkWarmup="), Settings.WarmupTime);
+	FParse::Value(CommandLine, TEXT("RPGBenchmarkDuration="), Settings.Duration);
+	FParse::Value(CommandLine, TEXT("RPGBenchmarkRadius="), Settings.SpawnRadius);
+	FParse::Value(CommandLine, TEXT("RPGBenchmarkName="), Settings.Name);
+	Settings.bQuitWhenDone = FParse::Param(CommandLine, TEXT("RPGBenchmarkQuit"));
+
+	FString ClassPath;
+	if (FParse::Value(CommandLine, TEXT("RPGBenchmarkAIClass="), ClassPath))
+	{
+		Settings.AIClass = LoadClass<ARPGCharacterBase>(nullptr, *ClassPath);
+	}
+
+	//bots default to the AI class, only the controller makes them a player
+	Settings.BotClass = Settings.AIClass;
+	if (FParse::Value(CommandLine, TEXT("RPGBenchmarkBotClass="), ClassPath))
+	{
+		Settings.BotClass = LoadClass<ARPGCharacterBase>(nullptr, *ClassPath);
+	}
+
+	FString AbilityPaths;
+	if (FParse::Value(CommandLine, TEXT("RPGBenchmarkAbilities="), AbilityPaths))
+	{
+		TArray<FString> Paths;
+		AbilityPaths.ParseIntoArray(Paths, TEXT("+"));
+
+		for (const FString& Path : Paths)
+		{
+			if (UClass* AbilityClass = LoadClass<UGameplayAbility>(nullptr, *Path))
+			{
+				Settings.AIAbilities.Add(AbilityClass);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Warning, TEXT("RPGBenchmark: couldn't load ability class %s"), *Path);
+			}
+		}
+	}
+
+	return Settings;
+}
+
+URPGBenchmarkSubsystem::URPGBenchmarkSubsystem()
+{
+	bAutoStartPending = false;
+	bRunning = false;
+	bMeasuring = false;
+	StartTime = 0.0f;
+	MeasureStartTime = 0.0f;
+	LastFrameSeconds = 0.0;
+	NumGarbageCollections = 0;
+	GarbageCollectionStartSeconds = 0.0;
+	GarbageCollectionMilliseconds = 0.0;
+}
+
+void URPGBenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bAutoStartPending = FParse::Param(FCommandLine::Get(), TEXT("RPGBenchmark"));
+
+	PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &URPGBenchmarkSubsystem::OnPreGarbageCollect);
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &URPGBenchmarkSubsystem::OnPostGarbageCollect);
+}
+
+void URPGBenchmarkSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+
+	Super::Deinitialize();
+}
+
+bool URPGBenchmarkSubsystem::StartBenchmark(const FRPGBenchmarkSettings& InSettings)
+{
+	UWorld* World = GetWorld();
+	if (bRunning || !World || World->GetNetMode() == NM_Client || !InSettings.AIClass)
+	{
+		return false;
+	}
+
+	Settings = InSettings;
+	LastSummaryPath.Reset();
+
+	bRunning = true;
+	bMeasuring = false;
+	StartTime = World->GetTimeSeconds();
+
+	SpawnCharacters();
+
+	UE_LOG(LogTemp, Log, TEXT("RPGBenchmark: started %s with %d AI and %d bots, %.1fs warmup, %.1fs measured"), *Settings.Name, Settings.NumAI, Settings.NumBots, Settings.WarmupTime, Settings.Duration);
+	return true;
+}
+
+void URPGBenchmarkSubsystem::SpawnCharacters()
+{
+	UWorld* World = GetWorld();
+
+	FVector Center = FVector::ZeroVector;
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		Center = It->GetActorLocation();
+		break;
+	}
+
+	for (int32 Index = 0; Index < Settings.NumBots; Index++)
+	{
+		SpawnCharacter(Settings.BotClass, Center, true);
+	}
+
+	for (int32 Index = 0; Index < Settings.NumAI; Index++)
+	{
+		ARPGCharacterBase* Character = SpawnCharacter(Settings.AIClass, Center, false);
+		UAbilitySystemComponent* AbilitySystemComponent = Character ? Character->GetAbilitySystemComponent() : nullptr;
+		if (!AbilitySystemComponent)
+		{
+			continue;
+		}
+
+		for (const TSubclassOf<UGameplayAbility>& Ability : Settings.AIAbilities)
+		{
+			URPGAIBlueprintHelperLibrary::GiveAbility(AbilitySystemComponent, Ability);
+		}
+	}
+}
+
+ARPGCharacterBase* URPGBenchmarkSubsystem::SpawnCharacter(TSubclassOf<ARPGCharacterBase> CharacterClass, const FVector& Center, bool bBot)
+{
+	UWorld* World = GetWorld();
+	if (!CharacterClass)
+	{
+		return nullptr;
+	}
+
+	FVector Location = Center;
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	FNavLocation NavLocation;
+	if (NavSys && NavSys->GetRandomReachablePointInRadius(Center, Settings.SpawnRadius, NavLocation))
+	{
+		Location = NavLocation.Location;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	//the capsule's half height above the nav location
+	Location.Z += CharacterClass->GetDefaultObject<ARPGCharacterBase>()->GetSimpleCollisionHalfHeight();
+
+	ARPGCharacterBase* Character = World->SpawnActor<ARPGCharacterBase>(CharacterClass, Location, FRotator(0.0f, FMath::FRandRange(-180.0f, 180.0f), 0.0f), SpawnParameters);
+	if (!Character)
+	{
+		return nullptr;
+	}
+
+	SpawnedActors.Add(Character);
+
+	if (bBot)
+	{
+		if (Character->GetController())
+		{
+			Character->GetController()->UnPossess();
+		}
+
+		ARPGBenchmarkBotController* Bot = World->SpawnActor<ARPGBenchmarkBotController>(SpawnParameters);
+		if (Bot)
+		{
+			Bot->Possess(Character);
+			SpawnedActors.Add(Bot);
+		}
+	}
+	else
+	{
+		if (!Character->GetController())
+		{
+			Character->SpawnDefaultController();
+		}
+
+		if (!Cast<ARPGAIController>(Character->GetController()))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("RPGBenchmark: %s isn't controlled by an ARPGAIController, set its AIControllerClass"), *GetNameSafe(CharacterClass));
+		}
+
+		SpawnedActors.Add(Character->GetController());
+	}
+
+	return Character;
+}
+
+void URPGBenchmarkSubsystem::BeginMeasuring()
+{
+	bMeasuring = true;
+	MeasureStartTime = GetWorld()->GetTimeSeconds();
+
+	FrameTimes.Reset();
+	NumGarbageCollections = 0;
+	GarbageCollectionMilliseconds = 0.0;
+	LastFrameSeconds = FPlatformTime::Seconds();
+
+#if CSV_PROFILER
+	FCsvProfiler::Get()->BeginCapture();
+#endif
+}
+
+void URPGBenchmarkSubsystem::FinishBenchmark()
+{
+#if CSV_PROFILER
+	FCsvProfiler::Get()->EndCapture();
+#endif
+
+	LastSummaryPath = WriteSummary();
+	UE_LOG(LogTemp, Log, TEXT("RPGBenchmark: finished %s, %d frames, summary %s"), *Settings.Name, FrameTimes.Num(), LastSummaryPath.IsEmpty() ? TEXT("not written") : *LastSummaryPath);
+
+	bRunning = false;
+	bMeasuring = false;
+
+	for (const TWeakObjectPtr<AActor>& Actor : SpawnedActors)
+	{
+		if (Actor.IsValid())
+		{
+			Actor->Destroy();
+		}
+	}
+	SpawnedActors.Reset();
+
+	if (Settings.bQuitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+FString URPGBenchmarkSubsystem::WriteSummary() const
+{
+	if (FrameTimes.Num() == 0)
+	{
+		return FString();
+	}
+
+	TArray<float> SortedFrameTimes = FrameTimes;
+	SortedFrameTimes.Sort();
+
+	auto Percentile = [&SortedFrameTimes](float Fraction)
+	{
+		const int32 Index = FMath::Clamp(FMath::FloorToInt(Fraction * (SortedFrameTimes.Num() - 1)), 0, SortedFrameTimes.Num() - 1);
+		return SortedFrameTimes[Index];
+	};
+
+	float TotalFrameTime = 0.0f;
+	for (const float FrameTime : FrameTimes)
+	{
+		TotalFrameTime += FrameTime;
+	}
+
+	int32 NumCharactersAlive = 0;
+	for (const TWeakObjectPtr<AActor>& Actor : SpawnedActors)
+	{
+		NumCharactersAlive += Cast<ARPGCharacterBase>(Actor.Get()) ? 1 : 0;
+	}
+
+	FString Csv = TEXT("Name,NetMode,NumAI,NumBots,NumCharactersAlive,Duration,Frames,FrameMsAvg,FrameMsP50,FrameMsP90,FrameMsP95,FrameMsP99,FrameMsMax,GCCount,GCMsTotal\n");
+	Csv += FString::Printf(TEXT("%s,%d,%d,%d,%d,%.2f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%.3f\n"),
+		*Settings.Name,
+		(int32)GetWorld()->GetNetMode(),
+		Settings.NumAI,
+		Settings.NumBots,
+		NumCharactersAlive,
+		Settings.Duration,
+		FrameTimes.Num(),
+		TotalFrameTime / FrameTimes.Num(),
+		Percentile(0.5f),
+		Percentile(0.9f),
+		Percentile(0.95f),
+		Percentile(0.99f),
+		SortedFrameTimes.Last(),
+		NumGarbageCollections,
+		GarbageCollectionMilliseconds);
+
+	const FString Path = FPaths::Combine(FPaths::ProfilingDir(), TEXT("RPGBenchmark"), FString::Printf(TEXT("%s_%s.csv"), *Settings.Name, *FDateTime::Now().ToString()));
+	return FFileHelper::SaveStringToFile(Csv, *Path) ? Path : FString();
+}
+
+void URPGBenchmarkSubsystem::OnPreGarbageCollect()
+{
+	GarbageCollectionStartSeconds = FPlatformTime::Seconds();
+}
+
+void URPGBenchmarkSubsystem::OnPostGarbageCollect()
+{
+	if (bMeasuring)
+	{
+		NumGarbageCollections++;
+		GarbageCollectionMilliseconds += (FPlatformTime::Seconds() - GarbageCollectionStartSeconds) * 1000.0;
+	}
+}
+
+void URPGBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+
+	if (bAutoStartPending)
+	{
+		if (!World->HasBegunPlay())
+		{
+			return;
+		}
+
+		bAutoStartPending = false;
+		if (!StartBenchmark(FRPGBenchmarkSettings::FromCommandLine()))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("RPGBenchmark: -RPGBenchmark given but the run couldn't start, not the server or no AI class (-RPGBenchmarkAIClass=)"));
+		}
+		return;
+	}
+
+	const float Now = World->GetTimeSeconds();
+
+	if (!bMeasuring)
+	{
+		if (Now - StartTime >= Settings.WarmupTime)
+		{
+			BeginMeasuring();
+		}
+		return;
+	}
+
+	const double FrameSeconds = FPlatformTime::Seconds();
+	FrameTimes.Add((float)((FrameSeconds - LastFrameSeconds) * 1000.0));
+	LastFrameSeconds = FrameSeconds;
+
+	CSV_CUSTOM_STAT(RPGBenchmark, NumSpawned, SpawnedActors.Num(), ECsvCustomStatOp::Set);
+
+	if (Now - MeasureStartTime >= Settings.Duration)
+	{
+		FinishBenchmark();
+	}
+}
+
+bool URPGBenchmarkSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return (bRunning || bAutoStartPending) && World && World->IsGameWorld() && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId URPGBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URPGBenchmarkSubsystem, STATGROUP_Tickables);
+}
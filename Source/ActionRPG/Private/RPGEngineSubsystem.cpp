@@ -3,12 +3,14 @@
 
 #include "RPGEngineSubsystem.h"
 #include "AbilitySystemGlobals.h"
+#include "RPGGameplayTags.h"
 
 void URPGEngineSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
 
 	UAbilitySystemGlobals::Get().InitGlobalData();
+	FRPGGameplayTags::InitializeNativeTags();
 
 	UE_LOG(LogTemp, Warning, TEXT("URPGEngineSubsystem::Initialize"));
 }
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RPGGameplayTags.h"
+#include "GameplayTagsManager.h"
+
+FGameplayTag FRPGGameplayTags::Data_Damage;
+FGameplayTag FRPGGameplayTags::Data_CooldownDuration;
+FGameplayTag FRPGGameplayTags::Event_ReceiveHit;
+FGameplayTag FRPGGameplayTags::Event_Hit_Melee;
+FGameplayTag FRPGGameplayTags::Cooldown_Input_Ability1;
+FGameplayTag FRPGGameplayTags::Cooldown_Input_Ability2;
+bool FRPGGameplayTags::bInitialized = false;
+
+void FRPGGameplayTags::InitializeNativeTags()
+{
+	if (bInitialized)
+	{
+		return;
+	}
+
+	bInitialized = true;
+
+	//the tag manager loads the tags from config the first time it's used, so this is safe to call from a constructor
+	TArray<FString> MissingTags;
+
+	AddTag(Data_Damage, "Data.Damage", MissingTags);
+	AddTag(Data_CooldownDuration, "Data.CooldownDuration", MissingTags);
+	AddTag(Event_ReceiveHit, "Event.ReceiveHit", MissingTags);
+	AddTag(Event_Hit_Melee, "Event.Hit.Melee", MissingTags);
+	AddTag(Cooldown_Input_Ability1, "Cooldown.Input.Ability1", MissingTags);
+	AddTag(Cooldown_Input_Ability2, "Cooldown.Input.Ability2", MissingTags);
+
+	if (MissingTags.Num() > 0)
+	{
+		UE_LOG(LogTemp, Fatal, TEXT("FRPGGameplayTags::InitializeNativeTags: missing gameplay tags [%s], add them to DefaultGameplayTags.ini"), *FString::Join(MissingTags, TEXT(", ")));
+	}
+}
+
+void FRPGGameplayTags::AddTag(FGameplayTag& OutTag, const ANSICHAR* TagName, TArray<FString>& OutMissingTags)
+{
+	//don't error inside the manager, we collect all the missing tags and report them together
+	OutTag = UGameplayTagsManager::Get().RequestGameplayTag(FName(TagName), false);
+
+	if (!OutTag.IsValid())
+	{
+		OutMissingTags.Add(FString(TagName));
+	}
+}
@@ -0,0 +1,424 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RPGReplicationGraph.h"
+#include "Items/RPGInventoryItemBase.h"
+#include "Character/RPGCharacterBase.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/WorldSettings.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("RPGReplicationGraph: route owned actors"), STAT_RPGReplicationGraph_RouteOwnedActors, STATGROUP_Game);
+
+URPGReplicationGraph::URPGReplicationGraph()
+{
+	SpatialGridCellSize = 10000.0f;
+	SpatialGridBias = FVector2D(-150000.0f, -200000.0f);
+	PlayerStatesPerFrame = 2;
+	DefaultNetUpdateFrequency = 10.0f;
+
+	GridNode = nullptr;
+	AlwaysRelevantNode = nullptr;
+	PlayerStateFrequencyLimiter = nullptr;
+}
+
+ERPGClassRepNodeMapping URPGReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	const ERPGClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(Class);
+	return Policy ? *Policy : ERPGClassRepNodeMapping::NotRouted;
+}
+
+ERPGClassRepNodeMapping URPGReplicationGraph::InferMappingPolicy(UClass* Class) const
+{
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+	if (ActorCDO->bAlwaysRelevant)
+	{
+		return ERPGClassRepNodeMapping::RelevantAllConnections;
+	}
+
+	if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		return ERPGClassRepNodeMapping::RelevantOwnerConnection;
+	}
+
+	//actors that don't replicate their movement are treated as if they never move
+	if (ActorCDO->IsReplicatingMovement() || Class->IsChildOf(APawn::StaticClass()))
+	{
+		return ERPGClassRepNodeMapping::Spatialize_Dynamic;
+	}
+
+	return ActorCDO->NetDormancy > DORM_Awake ? ERPGClassRepNodeMapping::Spatialize_Dormancy : ERPGClassRepNodeMapping::Spatialize_Static;
+}
+
+void URPGReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	//classes that are handled by a node that finds them itself, or not spatialized at all
+	ClassRepNodePolicies.Set(AReplicationGraphDebugActor::StaticClass(), ERPGClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), ERPGClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), ERPGClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(APlayerState::StaticClass(), ERPGClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(AGameStateBase::StaticClass(), ERPGClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(AWorldSettings::StaticClass(), ERPGClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(ARPGInventoryItemBase::StaticClass(), ERPGClassRepNodeMapping::InventoryItem);
+
+	const float MaxTickRate = NetDriver ? (float)NetDriver->NetServerMaxTickRate : 30.0f;
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject(false));
+		if (!ActorCDO || !ActorCDO->GetIsReplicated())
+		{
+			continue;
+		}
+
+		//skip the blueprint skeleton and reinstanced classes
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		if (!ClassRepNodePolicies.Contains(Class, false) && !ClassRepNodePolicies.Get(Class))
+		{
+			ClassRepNodePolicies.Set(Class, InferMappingPolicy(Class));
+		}
+
+		FClassReplicationInfo ClassInfo;
+		const float NetUpdateFrequency = ActorCDO->NetUpdateFrequency > 0.0f ? ActorCDO->NetUpdateFrequency : DefaultNetUpdateFrequency;
+		ClassInfo.ReplicationPeriodFrame = FMath::Max<uint32>((uint32)FMath::RoundToFloat(MaxTickRate / NetUpdateFrequency), 1);
+		ClassInfo.CullDistanceSquared = ActorCDO->NetCullDistanceSquared;
+
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+void URPGReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = SpatialGridCellSize;
+	GridNode->SpatialBias = SpatialGridBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	PlayerStateFrequencyLimiter = CreateNewNode<UReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	PlayerStateFrequencyLimiter->TargetActorsPerFrame = PlayerStatesPerFrame;
+	AddGlobalGraphNode(PlayerStateFrequencyLimiter);
+
+	ItemOwnerChangedHandle = ARPGInventoryItemBase::OnItemOwnerChanged.AddUObject(this, &URPGReplicationGraph::OnItemOwnerChanged);
+	ItemEquipChangedHandle = ARPGInventoryItemBase::OnItemEquipChanged.AddUObject(this, &URPGReplicationGraph::OnItemEquipChanged);
+}
+
+void URPGReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	URPGReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = CreateNewNode<URPGReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ConnectionNode, RepGraphConnection);
+
+	ConnectionNodes.Add(RepGraphConnection->NetConnection, ConnectionNode);
+}
+
+void URPGReplicationGraph::RemoveClientConnection(UNetConnection* NetConnection)
+{
+	URPGReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = nullptr;
+	ConnectionNodes.RemoveAndCopyValue(NetConnection, ConnectionNode);
+
+	Super::RemoveClientConnection(NetConnection);
+
+	if (!ConnectionNode)
+	{
+		return;
+	}
+
+	//the owned actors of the connection go to wherever they belong now
+	TArray<AActor*> OrphanedActors;
+	for (const TPair<TWeakObjectPtr<AActor>, FOwnedActorRoute>& Pair : OwnedActorRoutes)
+	{
+		if (Pair.Value.Route == EOwnedActorRoute::Connection && Pair.Value.ConnectionNode.Get() == ConnectionNode && Pair.Key.IsValid())
+		{
+			OrphanedActors.Add(Pair.Key.Get());
+		}
+	}
+
+	for (AActor* Actor : OrphanedActors)
+	{
+		OwnedActorRoutes.FindChecked(Actor).Route = EOwnedActorRoute::None;
+		RemoveOwnedActor(Actor);
+		AddOwnedActor(Actor);
+	}
+}
+
+void URPGReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case ERPGClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case ERPGClassRepNodeMapping::RelevantOwnerConnection:
+	case ERPGClassRepNodeMapping::InventoryItem:
+		AddOwnedActor(ActorInfo.Actor);
+		break;
+
+	case ERPGClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+
+	case ERPGClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+
+	case ERPGClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void URPGReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case ERPGClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	case ERPGClassRepNodeMapping::RelevantOwnerConnection:
+	case ERPGClassRepNodeMapping::InventoryItem:
+		if (ARPGInventoryItemBase* Item = Cast<ARPGInventoryItemBase>(ActorInfo.Actor))
+		{
+			OnItemEquipChanged(Item, nullptr);
+		}
+		RemoveOwnedActor(ActorInfo.Actor);
+		OwnedActorRoutes.Remove(ActorInfo.Actor);
+		break;
+
+	case ERPGClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+
+	case ERPGClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+
+	case ERPGClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+URPGReplicationGraphNode_AlwaysRelevant_ForConnection* URPGReplicationGraph::GetConnectionNode(const AActor* Actor) const
+{
+	UNetConnection* NetConnection = Actor ? Actor->GetNetConnection() : nullptr;
+	URPGReplicationGraphNode_AlwaysRelevant_ForConnection* const* ConnectionNode = NetConnection ? ConnectionNodes.Find(NetConnection) : nullptr;
+	return ConnectionNode ? *ConnectionNode : nullptr;
+}
+
+void URPGReplicationGraph::AddOwnedActor(AActor* Actor)
+{
+	if (!Actor)
+	{
+		return;
+	}
+
+	FOwnedActorRoute& Route = OwnedActorRoutes.FindOrAdd(Actor);
+	check(Route.Route == EOwnedActorRoute::None);
+
+	//items on the ground are spatialized like anything else
+	//picked up items stay in the grid until the non owners that could see them have been sent the new owner, then they move to the owner's connection
+	const ARPGInventoryItemBase* Item = Cast<ARPGInventoryItemBase>(Actor);
+	if (Item && (!Item->GetOwner() || Item->IsOwnerChangePending()))
+	{
+		GridNode->AddActor_Dormancy(FNewReplicatedActorInfo(Actor), GlobalActorReplicationInfoMap.Get(Actor));
+		Route.Route = EOwnedActorRoute::Grid;
+
+		if (Item->GetOwner())
+		{
+			PendingOwnedActors.AddUnique(Actor);
+		}
+		return;
+	}
+
+	if (URPGReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = GetConnectionNode(Actor))
+	{
+		ConnectionNode->NotifyAddNetworkActor(FNewReplicatedActorInfo(Actor));
+		Route.Route = EOwnedActorRoute::Connection;
+		Route.ConnectionNode = ConnectionNode;
+		return;
+	}
+
+	//owned by a remote player that isn't hooked up to its connection yet (player state created before the controller gets its connection)
+	//owned by an AI or the listen server's player, nothing else to do, equipped items are replicated with their avatar
+	for (AActor* Owner = Actor->GetOwner(); Owner; Owner = Owner->GetOwner())
+	{
+		const APlayerController* PlayerController = Cast<APlayerController>(Owner);
+		if (PlayerController && !PlayerController->IsLocalController())
+		{
+			Route.Route = EOwnedActorRoute::Pending;
+			PendingOwnedActors.AddUnique(Actor);
+			return;
+		}
+	}
+}
+
+void URPGReplicationGraph::RemoveOwnedActor(AActor* Actor)
+{
+	FOwnedActorRoute* Route = OwnedActorRoutes.Find(Actor);
+	if (!Route)
+	{
+		return;
+	}
+
+	switch (Route->Route)
+	{
+	case EOwnedActorRoute::Grid:
+		GridNode->RemoveActor_Dormancy(FNewReplicatedActorInfo(Actor));
+		PendingOwnedActors.Remove(Actor);
+		break;
+
+	case EOwnedActorRoute::Connection:
+		if (URPGReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = Route->ConnectionNode.Get())
+		{
+			ConnectionNode->NotifyRemoveNetworkActor(FNewReplicatedActorInfo(Actor));
+		}
+		break;
+
+	case EOwnedActorRoute::Pending:
+		PendingOwnedActors.Remove(Actor);
+		break;
+
+	default:
+		break;
+	}
+
+	Route->Route = EOwnedActorRoute::None;
+	Route->ConnectionNode = nullptr;
+}
+
+void URPGReplicationGraph::OnItemOwnerChanged(ARPGInventoryItemBase* Item, AActor* OldOwner)
+{
+	//the delegate is shared by every world
+	if (!Item || Item->GetWorld() != GetWorld() || !OwnedActorRoutes.Contains(Item))
+	{
+		return;
+	}
+
+	RemoveOwnedActor(Item);
+	AddOwnedActor(Item);
+}
+
+void URPGReplicationGraph::OnItemEquipChanged(ARPGInventoryItemBase* Item, ARPGCharacterBase* EquippedAvatar)
+{
+	if (!Item || Item->GetWorld() != GetWorld())
+	{
+		return;
+	}
+
+	FOwnedActorRoute& Route = OwnedActorRoutes.FindOrAdd(Item);
+	if (Route.EquippedAvatar.Get() == EquippedAvatar)
+	{
+		return;
+	}
+
+	//replicated to whoever the avatar is replicated to
+	if (FGlobalActorReplicationInfo* OldAvatarInfo = Route.EquippedAvatar.IsValid() ? GlobalActorReplicationInfoMap.Find(Route.EquippedAvatar.Get()) : nullptr)
+	{
+		OldAvatarInfo->DependentActorList.PrepareForWrite();
+		OldAvatarInfo->DependentActorList.Remove(Item);
+	}
+
+	if (EquippedAvatar)
+	{
+		FGlobalActorReplicationInfo& AvatarInfo = GlobalActorReplicationInfoMap.Get(EquippedAvatar);
+		AvatarInfo.DependentActorList.PrepareForWrite();
+		AvatarInfo.DependentActorList.ConditionalAdd(Item);
+	}
+
+	Route.EquippedAvatar = EquippedAvatar;
+}
+
+int32 URPGReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	if (PendingOwnedActors.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RPGReplicationGraph_RouteOwnedActors);
+
+		TArray<TWeakObjectPtr<AActor>> PendingActors = MoveTemp(PendingOwnedActors);
+		for (const TWeakObjectPtr<AActor>& Actor : PendingActors)
+		{
+			if (!Actor.IsValid())
+			{
+				continue;
+			}
+
+			//still in the grid until the new owner has been sent to the non owners
+			const ARPGInventoryItemBase* Item = Cast<ARPGInventoryItemBase>(Actor.Get());
+			if (Item && Item->IsOwnerChangePending())
+			{
+				PendingOwnedActors.AddUnique(Actor);
+				continue;
+			}
+
+			RemoveOwnedActor(Actor.Get());
+			AddOwnedActor(Actor.Get());
+		}
+	}
+
+	return Super::ServerReplicateActors(DeltaSeconds);
+}
+
+void URPGReplicationGraph::BeginDestroy()
+{
+	ARPGInventoryItemBase::OnItemOwnerChanged.Remove(ItemOwnerChangedHandle);
+	ARPGInventoryItemBase::OnItemEquipChanged.Remove(ItemEquipChangedHandle);
+
+	Super::BeginDestroy();
+}
+
+void URPGReplicationGraphNode_AlwaysRelevant_ForConnection::UpdateViewerActor(AActor* NewActor, AActor*& LastActor)
+{
+	if (NewActor == LastActor)
+	{
+		return;
+	}
+
+	if (LastActor)
+	{
+		ReplicationActorList.Remove(LastActor);
+	}
+
+	if (NewActor)
+	{
+		ReplicationActorList.ConditionalAdd(NewActor);
+	}
+
+	LastActor = NewActor;
+}
+
+void URPGReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	const APlayerController* PlayerController = Cast<APlayerController>(Params.Viewer.InViewer);
+
+	UpdateViewerActor(Params.Viewer.InViewer, LastViewer);
+	UpdateViewerActor(Params.Viewer.ViewTarget, LastViewTarget);
+	UpdateViewerActor(PlayerController ? PlayerController->PlayerState : nullptr, LastPlayerState);
+
+	//the viewer actors and the actors added with NotifyAddNetworkActor
+	Super::GatherActorListsForConnection(Params);
+}
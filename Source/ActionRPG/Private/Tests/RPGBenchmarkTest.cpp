@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RPGBenchmarkSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+#include "Tests/AutomationCommon.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//start the run in the loaded map with the settings from the command line
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FRPGStartBenchmarkCommand, FAutomationTestBase*, Test);
+
+bool FRPGStartBenchmarkCommand::Update()
+{
+	UWorld* World = AutomationCommon::GetAnyGameWorld();
+	URPGBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<URPGBenchmarkSubsystem>() : nullptr;
+	if (!Benchmark)
+	{
+		Test->AddError(TEXT("No game world with a URPGBenchmarkSubsystem"));
+		return true;
+	}
+
+	//the run may have to wait for the world to begin play, same as -RPGBenchmark
+	if (!World->HasBegunPlay())
+	{
+		return false;
+	}
+
+	//the automation controller decides when to exit
+	FRPGBenchmarkSettings Settings = FRPGBenchmarkSettings::FromCommandLine();
+	Settings.bQuitWhenDone = false;
+
+	if (!Benchmark->StartBenchmark(Settings))
+	{
+		Test->AddError(TEXT("The benchmark couldn't start, already running, not the server or no AI class (-RPGBenchmarkAIClass=)"));
+	}
+
+	return true;
+}
+
+//wait for the run to finish and check the summary was written
+DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FRPGWaitForBenchmarkCommand, FAutomationTestBase*, Test, float, Timeout);
+
+bool FRPGWaitForBenchmarkCommand::Update()
+{
+	UWorld* World = AutomationCommon::GetAnyGameWorld();
+	URPGBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<URPGBenchmarkSubsystem>() : nullptr;
+	if (!Benchmark)
+	{
+		Test->AddError(TEXT("The benchmark world went away before the run finished"));
+		return true;
+	}
+
+	if (Benchmark->IsRunning())
+	{
+		if (GetCurrentRunTime() > Timeout)
+		{
+			Test->AddError(FString::Printf(TEXT("The benchmark didn't finish in %.0f seconds"), Timeout));
+			return true;
+		}
+
+		return false;
+	}
+
+	if (Benchmark->GetLastSummaryPath().IsEmpty())
+	{
+		Test->AddError(TEXT("The benchmark finished without writing a summary"));
+	}
+	else
+	{
+		Test->AddInfo(FString::Printf(TEXT("Summary written to %s"), *Benchmark->GetLastSummaryPath()));
+	}
+
+	return true;
+}
+
+/**
+ * runs URPGBenchmarkSubsystem in a map and fails if it doesn't finish or write its summary
+ * the map is -RPGBenchmarkMap=/Game/Maps/Map, or the loaded one, the rest of the settings come from the same command line as -RPGBenchmark
+ */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FRPGBenchmarkTest, "ActionRPG.Benchmark", EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+void FRPGBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	FString MapName;
+	if (FParse::Value(FCommandLine::Get(), TEXT("RPGBenchmarkMap="), MapName))
+	{
+		OutBeautifiedNames.Add(FPaths::GetBaseFilename(MapName));
+		OutTestCommands.Add(MapName);
+	}
+	else
+	{
+		OutBeautifiedNames.Add(TEXT("LoadedMap"));
+		OutTestCommands.Add(FString());
+	}
+}
+
+bool FRPGBenchmarkTest::RunTest(const FString& Parameters)
+{
+	if (!Parameters.IsEmpty() && !AutomationOpenMap(Parameters))
+	{
+		AddError(FString::Printf(TEXT("Couldn't open %s"), *Parameters));
+		return false;
+	}
+
+	//the warmup and duration are world seconds, a slow run gets as long again on the wall clock before it's failed
+	const FRPGBenchmarkSettings Settings = FRPGBenchmarkSettings::FromCommandLine();
+	const float Timeout = 2.0f * (Settings.WarmupTime + Settings.Duration) + 60.0f;
+
+	ADD_LATENT_AUTOMATION_COMMAND(FRPGStartBenchmarkCommand(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FRPGWaitForBenchmarkCommand(this, Timeout));
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -6,6 +6,17 @@
 #include "AIController.h"
 #include "RPGAIController.generated.h"
 
+/** how the controlled pawn avoids other pawns while following a path */
+UENUM(BlueprintType)
+enum class ERPGAvoidanceMode : uint8
+{
+	None,
+	//the character movement RVO, uses the engine's avoidance manager
+	CharacterMovementRVO,
+	//URPGPathFollowingComponent avoidance with the neighbours from URPGPawnSpatialSubsystem
+	SpatialGrid
+};
+
 /**
  * 
  */
@@ -16,4 +27,28 @@ class ACTIONRPG_API ARPGAIController : public AAIController
 	
 public:
 	ARPGAIController(const FObjectInitializer& ObjectInitializer);
+
+	/** queues the query with URPGPathRequestSubsystem and returns a path that is filled next frame, the move waits on it until then */
+	virtual void FindPathForMoveRequest(const FAIMoveRequest& MoveRequest, FPathFindingQuery& Query, FNavPathSharedPtr& OutPath) const override;
+
+	UFUNCTION(BlueprintCallable, Category = "AI")
+	void SetAvoidanceMode(ERPGAvoidanceMode NewAvoidanceMode);
+
+	ERPGAvoidanceMode GetAvoidanceMode() const { return AvoidanceMode; }
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	ERPGAvoidanceMode AvoidanceMode;
+
+	//set up the path following component and the pawn's movement for AvoidanceMode
+	void ApplyAvoidanceMode();
+
+	//single segment path to the goal actor for a path following component that uses a flow field, false if the field isn't built yet or doesn't reach us
+	bool FindFlowFieldPath(const FAIMoveRequest& MoveRequest, const FPathFindingQuery& Query, FNavPathSharedPtr& OutPath) const;
+
+	//false to find paths on the game thread when the move is requested
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	bool bUseAsyncPathfinding;
 };
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/RPGAIController.h"
+#include "RPGBenchmarkBotController.generated.h"
+
+/**
+ * stand in for a player in URPGBenchmarkSubsystem runs, has a player state so the AI treat its pawn as a player (see URPGPawnSpatialSubsystem)
+ * wanders between random reachable points around where it was possessed
+ */
+UCLASS()
+class ACTIONRPG_API ARPGBenchmarkBotController : public ARPGAIController
+{
+	GENERATED_BODY()
+
+public:
+	ARPGBenchmarkBotController(const FObjectInitializer& ObjectInitializer);
+
+	//how far from the possess location the bot wanders
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	float WanderRadius;
+
+	//seconds between picking a new point
+	UPROPERTY(EditAnywhere, Category = "Benchmark")
+	float WanderInterval;
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+
+	virtual void OnUnPossess() override;
+
+	void Wander();
+
+	FVector HomeLocation;
+
+	FTimerHandle WanderTimerHandle;
+};
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "RPGFlowFieldSubsystem.generated.h"
+
+class ARecastNavMesh;
+
+/**
+ * Distance field over the navmesh polys towards one target, filled with a dijkstra from the target's poly
+ * every reached poly knows the next poly towards the target and the middle of the edge shared with it
+ */
+struct ACTIONRPG_API FRPGFlowField
+{
+	struct FNode
+	{
+		//path distance to the target
+		float Distance;
+		//next poly towards the target, INVALID_NAVNODEREF on the target poly
+		NavNodeRef NextPoly;
+		//middle of the edge shared with NextPoly
+		FVector PortalLocation;
+	};
+
+	FRPGFlowField();
+
+	/**
+	 * fill the field from the target outwards, reuses the memory of the previous fill
+	 * only reads the navmesh, so fields can be built in parallel
+	 * @param MaxDistance polys further than this from the target are not in the field
+	 * @param MaxNodes stop the fill after this many polys
+	 */
+	void Build(const ARecastNavMesh& NavMesh, const FVector& InTargetLocation, NavNodeRef InTargetPoly, float MaxDistance, int32 MaxNodes);
+
+	/**
+	 * where to move next from a poly
+	 * @return false if the poly is not in the field
+	 */
+	bool Sample(NavNodeRef Poly, FVector& OutMoveTarget) const;
+
+	const FNode* FindNode(NavNodeRef Poly) const { return Nodes.Find(Poly); }
+
+	int32 Num() const { return Nodes.Num(); }
+
+	NavNodeRef GetTargetPoly() const { return TargetPoly; }
+
+	const FVector& GetTargetLocation() const { return TargetLocation; }
+
+private:
+	TMap<NavNodeRef, FNode> Nodes;
+
+	NavNodeRef TargetPoly;
+
+	FVector TargetLocation;
+
+	struct FOpenNode
+	{
+		NavNodeRef Poly;
+		float Distance;
+		//where the poly was entered from, the distance is measured between these
+		FVector Location;
+
+		bool operator<(const FOpenNode& Other) const { return Distance < Other.Distance; }
+	};
+
+	//reused between builds
+	TArray<FOpenNode> OpenList;
+	TArray<FNavigationPortalEdge> Neighbors;
+};
+
+/**
+ * Keeps a flow field towards each actor that AI are moving to with flow fields, rebuilt every UpdateInterval
+ * a field is made when it is first requested (so the first move still uses a normal path) and dropped once nobody requested it for a while
+ * used by ARPGAIController and URPGPathFollowingComponent when bUseFlowField is set, hordes chasing the same few players share one fill per player instead of one search each
+ * the tuning values are set in DefaultGame.ini, subsystems can't be edited in the editor
+ */
+UCLASS(Config = Game)
+class ACTIONRPG_API URPGFlowFieldSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	URPGFlowFieldSubsystem();
+
+	/**
+	 * get the field towards the target and keep it updated, request it again every frame instead of keeping the pointer
+	 * @return nullptr until the field has been built
+	 */
+	const FRPGFlowField* RequestFlowField(const AActor* Target);
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+protected:
+	//seconds between rebuilds of a field
+	UPROPERTY(Config)
+	float UpdateInterval;
+
+	//a field nobody requested for this long is dropped
+	UPROPERTY(Config)
+	float UnusedTimeout;
+
+	//path distance covered by a field, AI further away use normal paths
+	UPROPERTY(Config)
+	float MaxFieldDistance;
+
+	UPROPERTY(Config)
+	int32 MaxFieldNodes;
+
+private:
+	struct FTargetField
+	{
+		TWeakObjectPtr<const AActor> Target;
+		FRPGFlowField Field;
+		bool bBuilt;
+		float LastBuildTime;
+		float LastRequestTime;
+		//set for the fields rebuilt this tick
+		NavNodeRef PendingTargetPoly;
+		FVector PendingTargetLocation;
+	};
+
+	//heap allocated so the field pointers handed out stay valid when the array grows
+	TArray<TUniquePtr<FTargetField>> Fields;
+
+	//reused every tick
+	TArray<FTargetField*> FieldsToBuild;
+};
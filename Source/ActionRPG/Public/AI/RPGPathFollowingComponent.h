@@ -8,9 +8,11 @@
 #include "NavMesh/RecastNavMesh.h"
 #include "RPGPathFollowingComponent.generated.h"
 
+class ARPGRecastNavMesh;
+
 /**
- * #TODO pass in the nav data to the getpoly verts etc.. 
- * #TODO override OnPathFinished and check FPathFollowingResultFlags::Blocked
+ * the poly queries go through the poly cache of ARPGRecastNavMesh, other navmeshes fall back to the slower ARecastNavMesh queries
+ * blocked moves, partial paths and failed searches back off the next path request exponentially, checked by ARPGAIController::FindPathForMoveRequest
  */
 UCLASS()
 class ACTIONRPG_API URPGPathFollowingComponent : public UPathFollowingComponent
@@ -20,10 +22,81 @@ class ACTIONRPG_API URPGPathFollowingComponent : public UPathFollowingComponent
 public:
 	URPGPathFollowingComponent(const FObjectInitializer& ObjectInitializer);
 
+	bool UsesFlowField() const { return bUseFlowField; }
+
+	//false while backing off after a failed move
+	bool CanRequestPath() const;
+
+	//blocked, partial or failed moves in a row
+	int32 GetConsecutivePathFailures() const { return ConsecutivePathFailures; }
+
+	//push the next allowed path request back, doubling the delay for every failure in a row
+	void RegisterPathFailure();
+
+	void ResetPathFailures();
+
+	virtual void OnPathFinished(const FPathFollowingResult& Result) override;
+
+	/**
+	 * steer the path following move away from nearby pawns, neighbours come from URPGPawnSpatialSubsystem
+	 * reciprocal velocity obstacles: candidate velocities around the preferred one are scored by their time to collision with each neighbour
+	 */
+	void SetGridAvoidanceEnabled(bool bEnabled);
+
+	bool IsGridAvoidanceEnabled() const { return bUseGridAvoidance; }
+
 protected:
 	/** follow current path segment */
 	virtual void FollowPathSegment(float DeltaTime) override;
 
+	/**
+	 * steer along the URPGFlowFieldSubsystem field towards the goal actor instead of the path points, only on the last path segment
+	 * the flow field paths made by ARPGAIController only have the one segment
+	 * @return false if there's no field or we're not in it, follow the path instead
+	 */
+	bool FollowFlowField(float DeltaTime);
+
+	//move to actors by sampling a shared flow field instead of following an individual path
+	UPROPERTY(EditDefaultsOnly, Category = "Flow Field")
+	bool bUseFlowField;
+
+	//delay before the next path request after the first failure
+	UPROPERTY(EditDefaultsOnly, Category = "Repath")
+	float RepathBackoffBaseDelay;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Repath")
+	float RepathBackoffMaxDelay;
+
+	//a partial path is finished as blocked once we are this close to its end, it can't get us any closer
+	UPROPERTY(EditDefaultsOnly, Category = "Repath")
+	float PartialPathEndTolerance;
+
+	//pawns closer than this are avoided
+	UPROPERTY(EditDefaultsOnly, Category = "Avoidance")
+	float AvoidanceNeighbourRadius;
+
+	//only the closest neighbours are considered
+	UPROPERTY(EditDefaultsOnly, Category = "Avoidance")
+	int32 MaxAvoidanceNeighbours;
+
+	//collisions further away in time than this are ignored
+	UPROPERTY(EditDefaultsOnly, Category = "Avoidance")
+	float AvoidanceTimeHorizon;
+
+	//how much a close collision costs against deviating from the preferred velocity
+	UPROPERTY(EditDefaultsOnly, Category = "Avoidance")
+	float AvoidanceCollisionWeight;
+
+	bool bUseGridAvoidance;
+
+	//bound to PostProcessMove while the grid avoidance is enabled, Move is a velocity or an acceleration input depending on the movement component
+	void ApplyGridAvoidance(UPathFollowingComponent* PathFollowingComponent, FVector& Move);
+
+	int32 ConsecutivePathFailures;
+
+	//world time of the next allowed path request
+	float NextPathRequestTime;
+
 	/**
 	 * Get main Nav Data, called by GetNavData if MovementComponent or Nav Data on NavAgent on MovementComponent is not found
 	 */
@@ -44,10 +117,25 @@ protected:
 		return NavSys->GetDefaultNavDataInstance();
 	}
 
+	virtual void SetMovementComponent(UNavMovementComponent* MoveComp) override;
+
 	/**
-	 * Get the nav data for the agent
+	 * Get the nav data for the agent, cached until the movement component changes
 	 */
 	FORCEINLINE const ANavigationData* GetNavData() const
+	{
+		if (!CachedNavData.IsValid())
+		{
+			CachedNavData = FindNavData();
+		}
+
+		return CachedNavData.Get();
+	}
+
+	/**
+	 * look up the nav data for the agent
+	 */
+	FORCEINLINE const ANavigationData* FindNavData() const
 	{
 		if (!MovementComp)
 		{
@@ -86,7 +174,7 @@ protected:
 		return TileBounds.IsValid != 0;
 	}
 
-	//#TODO pass in nav data cast Cast<ARecastNavMesh>(NavData) so we can call NavPoly_GetLocation etc.. without having to call GetnavData over and over again 
+	//OutPolys is not reset, so it can be reused without reallocating
 	bool GetAllPolys(TArray<NavNodeRef>& OutPolys);
 
 	//Verts
@@ -94,4 +182,25 @@ protected:
 
 	//Bounds
 	FBox NavPoly_GetBounds(const NavNodeRef& PolyID) const;
+
+	//Center
+	bool NavPoly_GetCenter(const NavNodeRef& PolyID, FVector& OutCenter) const;
+
+	/**
+	 * the poly with the closest bounds to the location, only with the poly cache of ARPGRecastNavMesh
+	 * @return INVALID_NAVNODEREF if there's none within MaxDistance
+	 */
+	NavNodeRef NavPoly_FindNearest(const FVector& Location, float MaxDistance, FBox& OutBounds) const;
+
+	//the nav data as ARPGRecastNavMesh, nullptr for any other nav data
+	const ARPGRecastNavMesh* GetRPGNavMesh() const;
+
+private:
+	mutable TWeakObjectPtr<const ANavigationData> CachedNavData;
+
+	//reused by NavPoly_GetBounds when the poly cache can't be used
+	mutable TArray<FVector> PolyVertsScratch;
+
+	//reused by ApplyGridAvoidance
+	TArray<APawn*> AvoidanceNeighbours;
 };
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "NavigationData.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "RPGPathRequestSubsystem.generated.h"
+
+class UPathFollowingComponent;
+
+/**
+ * Batches the AI path requests made during a frame and runs them in parallel on worker threads
+ * the batch is kicked off after the actors tick and finished at the start of the next world tick, before the navigation system
+ * can change the navmesh, the results are copied into the paths the path following components are waiting on
+ * used by ARPGAIController::FindPathForMoveRequest, the path following component waits (EPathFollowingStatus::Waiting) until the path is filled
+ * the paths chasing an actor are observed here as well so their repaths go in the batch instead of ANavigationData::RequestRePath
+ * the tuning values are set in DefaultGame.ini, subsystems can't be edited in the editor
+ */
+UCLASS(Config = Game)
+class ACTIONRPG_API URPGPathRequestSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	URPGPathRequestSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	/**
+	 * queue a path query for the next batch, PendingPath is filled and marked ready when the batch is finished
+	 * a newer request for the same path following component replaces the queued one
+	 * @param PathFollowingComponent aborted with InvalidPath if no path is found and it's still waiting on PendingPath
+	 */
+	void RequestPath(const FPathFindingQuery& Query, FNavPathSharedPtr PendingPath, UPathFollowingComponent* PathFollowingComponent);
+
+	int32 GetNumQueuedRequests() const { return QueuedRequests.Num(); }
+
+	/**
+	 * queue a repath of Path when its goal actor moves further than TetherDistance from where the path was last found to
+	 * the path should observe the goal actor with a tether of WORLD_MAX so the navigation data never repaths it on the game thread
+	 * stops when the path following component moves on to another path or the goal actor is gone
+	 */
+	void ObservePath(FNavPathSharedPtr Path, UPathFollowingComponent* PathFollowingComponent, float TetherDistance);
+
+	/**
+	 * repaths of AI that failed their last move share MaxRepathsPerFrame, the rest wait for a later frame
+	 * @return false if the quota of this frame is used up
+	 */
+	bool ConsumeRepathQuota();
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+protected:
+	//requests per ParallelFor work item, pathfinding has a lot of variance so keep it small
+	UPROPERTY(Config)
+	int32 RequestsPerWorkItem;
+
+	UPROPERTY(Config)
+	int32 MaxRepathsPerFrame;
+
+	//wait for the batch in flight and deliver its results
+	void FinishBatch();
+
+	//queue the repaths of the observed paths whose goal actor moved
+	void TickObservedPaths();
+
+	void OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+	//the workers read weak pointers to the nav data and the query owners, which GC would clear under them
+	void OnPreGarbageCollect();
+
+private:
+	struct FPathRequest
+	{
+		FPathFindingQuery Query;
+		FNavPathSharedPtr PendingPath;
+		TWeakObjectPtr<UPathFollowingComponent> PathFollowingComponent;
+		//GoalMoved for the repaths of observed paths
+		ENavPathUpdateType::Type UpdateType;
+		//written by the worker thread
+		FPathFindingResult Result;
+		//replaced by a newer request before the batch was kicked off
+		bool bCancelled;
+	};
+
+	//requests made this frame
+	TArray<FPathRequest> QueuedRequests;
+
+	//index into QueuedRequests of the latest request of each path following component
+	TMap<const UPathFollowingComponent*, int32> QueuedRequestIndices;
+
+	//requests being processed by the worker threads, not touched on the game thread until BatchTask is complete
+	TArray<FPathRequest> InFlightRequests;
+
+	struct FObservedPath
+	{
+		FNavPathWeakPtr Path;
+		TWeakObjectPtr<UPathFollowingComponent> PathFollowingComponent;
+		float TetherDistanceSq;
+	};
+
+	TArray<FObservedPath> ObservedPaths;
+
+	FGraphEventRef BatchTask;
+
+	FDelegateHandle WorldTickStartHandle;
+	FDelegateHandle PreGarbageCollectHandle;
+
+	int32 NumRepathsThisFrame;
+	uint64 RepathQuotaFrame;
+};
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "RPGPawnSpatialSubsystem.generated.h"
+
+/**
+ * Uniform grid over the XY plane, entries are sorted by cell so each cell is a contiguous range of the entry array
+ * rebuilt from scratch every frame, the arrays keep their memory between rebuilds so there's no allocation after the first few frames
+ * distances are always compared squared, the Z is included in the distance but not in the cell
+ */
+struct ACTIONRPG_API FRPGPawnSpatialGrid
+{
+	struct FEntry
+	{
+		APawn* Pawn;
+		FVector Location;
+		uint64 CellKey;
+	};
+
+	struct FCell
+	{
+		int32 Start;
+		int32 Num;
+	};
+
+	FRPGPawnSpatialGrid();
+
+	//clear the grid for a rebuild
+	void Reset(float InCellSize);
+
+	void Add(APawn* Pawn, const FVector& Location);
+
+	//sort the entries and build the cells, must be called after adding all the entries
+	void Finalize();
+
+	/**
+	 * find the nearest pawn to the origin
+	 * @param Ignore pawn to skip, i.e. the querier
+	 * @return nullptr if nothing was found within MaxDistance
+	 */
+	APawn* FindNearest(const FVector& Origin, float MaxDistance, const APawn* Ignore, float& OutDistanceSquared) const;
+
+	/**
+	 * add all the pawns within the radius to OutPawns, OutPawns is not reset so reuse it with Reset() to avoid allocating
+	 * @return the number of pawns added
+	 */
+	int32 FindWithinRadius(const FVector& Origin, float Radius, const APawn* Ignore, TArray<APawn*>& OutPawns) const;
+
+	int32 Num() const { return Entries.Num(); }
+
+	const TArray<FEntry>& GetEntries() const { return Entries; }
+
+private:
+	float CellSize;
+	float InvCellSize;
+
+	TArray<FEntry> Entries;
+	TMap<uint64, FCell> Cells;
+
+	//cell extents, used to stop the ring search once it has covered the whole grid
+	FIntPoint MinCell;
+	FIntPoint MaxCell;
+
+	FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt(Location.X * InvCellSize), FMath::FloorToInt(Location.Y * InvCellSize));
+	}
+
+	static uint64 MakeCellKey(int32 X, int32 Y)
+	{
+		return ((uint64)(uint32)X << 32) | (uint64)(uint32)Y;
+	}
+
+	const FCell* FindCell(int32 X, int32 Y) const
+	{
+		return Cells.Find(MakeCellKey(X, Y));
+	}
+};
+
+/**
+ * World subsystem that keeps a spatial index of the player and AI pawns, updated once per frame
+ * pawns register themselves in ARPGCharacterBase::BeginPlay/EndPlay, whether they're a player or AI is decided on every update
+ * used by URPGAIBlueprintHelperLibrary::GetNearestPlayerPawn so hundreds of AI querying every BT tick don't each walk the player array
+ * the cell size is set in DefaultGame.ini, subsystems can't be edited in the editor
+ */
+UCLASS(Config = Game)
+class ACTIONRPG_API URPGPawnSpatialSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	URPGPawnSpatialSubsystem();
+
+	void RegisterPawn(APawn* Pawn);
+
+	void UnregisterPawn(APawn* Pawn);
+
+	//true once the grids were built at least once
+	bool HasUpdated() const { return LastUpdateFrame != 0; }
+
+	APawn* FindNearestPlayerPawn(const FVector& Origin, float& OutDistanceSquared, const APawn* Ignore = nullptr, float MaxDistance = BIG_NUMBER) const;
+
+	APawn* FindNearestAIPawn(const FVector& Origin, float& OutDistanceSquared, const APawn* Ignore = nullptr, float MaxDistance = BIG_NUMBER) const;
+
+	int32 FindPlayerPawnsInRadius(const FVector& Origin, float Radius, TArray<APawn*>& OutPawns, const APawn* Ignore = nullptr) const;
+
+	int32 FindAIPawnsInRadius(const FVector& Origin, float Radius, TArray<APawn*>& OutPawns, const APawn* Ignore = nullptr) const;
+
+	const FRPGPawnSpatialGrid& GetPlayerGrid() const { return PlayerGrid; }
+
+	const FRPGPawnSpatialGrid& GetAIGrid() const { return AIGrid; }
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+protected:
+	//size of the grid cells, should be around the usual query radius
+	UPROPERTY(Config)
+	float CellSize;
+
+	//rebuild both grids from the registered pawns
+	void UpdateGrids();
+
+private:
+	TArray<TWeakObjectPtr<APawn>> RegisteredPawns;
+
+	FRPGPawnSpatialGrid PlayerGrid;
+
+	FRPGPawnSpatialGrid AIGrid;
+
+	uint64 LastUpdateFrame;
+};
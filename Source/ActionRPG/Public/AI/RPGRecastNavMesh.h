@@ -6,8 +6,36 @@
 #include "NavMesh/RecastNavMesh.h"
 #include "RPGRecastNavMesh.generated.h"
 
+class dtNavMesh;
+class dtNavMeshQuery;
+
+/** cached geometry of the ground polys of one navmesh tile, one array per field so the bounds can be scanned without touching the rest */
+struct ACTIONRPG_API FRPGNavTilePolys
+{
+	TArray<NavNodeRef> PolyRefs;
+	TArray<FBox> Bounds;
+	TArray<FVector> Centers;
+
+	//poly index in the tile to index into the arrays above, INDEX_NONE for polys that aren't cached (off mesh links)
+	TArray<int32> PolyIndexToSlot;
+
+	//all the poly bounds of the tile, invalid for an empty tile
+	FBox TileBounds;
+
+	FRPGNavTilePolys()
+		: TileBounds(ForceInit)
+	{
+	}
+
+	int32 Num() const { return PolyRefs.Num(); }
+
+	void Reset();
+};
+
 /**
- * 
+ * Recast navmesh with its own FindPath, a bounded A* over the detour mesh with a cache of poly corridors
+ * repeated queries between the same start and end polys (AI chasing the same player) only redo the string pulling
+ * the cache is invalidated per tile when tiles are rebuilt, FindPath can be called from the async pathfinding threads
  */
 UCLASS()
 class ACTIONRPG_API ARPGRecastNavMesh : public ARecastNavMesh
@@ -18,4 +46,113 @@ public:
 	ARPGRecastNavMesh(const FObjectInitializer& ObjectInitializer);
 	static FPathFindingResult FindPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query);
 
+	virtual void OnNavMeshTilesUpdated(const TArray<uint32>& ChangedTiles) override;
+
+	virtual void BeginDestroy() override;
+
+	//drop every cached corridor
+	void FlushPathCache();
+
+	//hits / (hits + misses) since the cache was created
+	float GetPathCacheHitRate() const;
+
+	/**
+	 * poly refs, bounds and centers of every tile, built on first use and rebuilt per tile in OnNavMeshTilesUpdated
+	 * game thread only, indexed by tile index
+	 */
+	const TArray<FRPGNavTilePolys>& GetCachedTilePolys() const;
+
+	//append every cached poly ref, @return the number added
+	int32 GetCachedPolys(TArray<NavNodeRef>& OutPolys) const;
+
+	//@return false if the poly isn't in the cache
+	bool GetCachedPolyBounds(NavNodeRef PolyRef, FBox& OutBounds) const;
+
+	bool GetCachedPolyCenter(NavNodeRef PolyRef, FVector& OutCenter) const;
+
+	/**
+	 * the poly whose bounds are closest to the location, tiles further than MaxDistance are skipped
+	 * @return INVALID_NAVNODEREF if there's no poly within MaxDistance
+	 */
+	NavNodeRef FindNearestCachedPoly(const FVector& Location, float MaxDistance, FBox* OutBounds = nullptr) const;
+
+protected:
+	//max corridors kept, the least recently used one is dropped when full
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+	int32 MaxCachedPaths;
+
+	//false to always run the search, e.g. to compare against the cache
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+	bool bUsePathCache;
+
+private:
+	void BuildPolyCache() const;
+
+	void BuildTilePolys(int32 TileIndex) const;
+
+	const FRPGNavTilePolys* FindCachedTilePolys(NavNodeRef PolyRef, int32& OutSlot) const;
+
+	//game thread only, mutable so the lazy build can happen in the const getters
+	mutable TArray<FRPGNavTilePolys> CachedTilePolys;
+
+	mutable bool bPolyCacheBuilt;
+
+	//the detour mesh the poly cache was built from, rebuilt when it is recreated
+	mutable const dtNavMesh* PolyCacheDetourMesh;
+
+	//reused by BuildTilePolys
+	mutable TArray<FNavPoly> TilePolysScratch;
+	mutable TArray<FVector> PolyVertsScratch;
+
+	struct FPathCacheKey
+	{
+		NavNodeRef StartPoly;
+		NavNodeRef EndPoly;
+		//filters are shared per filter class, so the pointer identifies the costs
+		const void* Filter;
+
+		bool operator==(const FPathCacheKey& Other) const
+		{
+			return StartPoly == Other.StartPoly && EndPoly == Other.EndPoly && Filter == Other.Filter;
+		}
+
+		friend uint32 GetTypeHash(const FPathCacheKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.StartPoly), GetTypeHash(Key.EndPoly)), PointerHash(Key.Filter));
+		}
+	};
+
+	struct FPathCacheEntry
+	{
+		TArray<NavNodeRef> Corridor;
+		TArray<float> CorridorCost;
+		//the search ran out of nodes or didn't reach the end poly
+		bool bPartial;
+		bool bReachedSearchLimit;
+		uint64 LastUsed;
+	};
+
+#if WITH_RECAST
+	bool FindCachedCorridor(const FPathCacheKey& Key, const dtNavMesh* DetourMesh, FPathCacheEntry& OutEntry) const;
+	void AddCachedCorridor(const FPathCacheKey& Key, const dtNavMesh* DetourMesh, const FPathCacheEntry& Entry) const;
+
+	//node pools are allocated once per query object and reused, init only clears them when they are big enough
+	dtNavMeshQuery* AcquireNavQuery(const dtNavMesh* DetourMesh, int32 MaxSearchNodes) const;
+	void ReleaseNavQuery(dtNavMeshQuery* NavQuery) const;
+#endif // WITH_RECAST
+
+	//FindPath is static and may run on several threads, everything below is guarded by PathCacheLock
+	mutable FCriticalSection PathCacheLock;
+
+	mutable TMap<FPathCacheKey, FPathCacheEntry> PathCache;
+
+	//the detour mesh the cached refs belong to, the cache is flushed when it is recreated
+	mutable const dtNavMesh* PathCacheDetourMesh;
+
+	mutable uint64 PathCacheUseCounter;
+
+	mutable TArray<dtNavMeshQuery*> FreeNavQueries;
+
+	mutable FThreadSafeCounter PathCacheHits;
+	mutable FThreadSafeCounter PathCacheMisses;
 };
@@ -19,6 +19,17 @@ public:
 	//need to override this since AGameplayAbilityTargetActor_Trace set bDebug to false here always
 	virtual void ConfirmTargetingAndContinue() override;
 
+	//the actor is reused by the target actor pool, so destroy the reticle from the last use before Super spawns a new one
+	virtual void StartTargeting(UGameplayAbility* Ability) override;
+
+	/**
+	 * the trace used by PerformTrace without needing an actor, aims along the player controller view (clipped to MaxRange around TraceStart) like AimWithPlayerController
+	 * and then traces from TraceStart towards the aim point, used by URPGHitscanAbility so a shot doesn't have to spawn a target actor
+	 * @param PC the player controller to aim with, if null the trace goes along the source actor's forward vector
+	 * @param OutTraceEnd the end of the final trace, the hit location defaults to this if nothing was hit
+	 */
+	static FHitResult PerformLineTrace(const AActor* InSourceActor, APlayerController* PC, const FVector& TraceStart, float InMaxRange, const FGameplayTargetDataFilterHandle& InFilter, FName InTraceProfile, bool bInTraceAffectsAimPitch, FVector& OutTraceEnd);
+
 protected:
 	virtual FHitResult PerformTrace(AActor* InSourceActor) override; //#TODO right now it's doing the trace from the overhead camera, do another trace from the character pos/weapon muzzle to hit
 };
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
+#include "Engine/NetSerialization.h"
+#include "RPGAbilityTargetTypes.generated.h"
+
+/**
+ * line trace hit sent by the client for every shot, replaces FGameplayAbilityTargetData_SingleTargetHit which sends the whole FHitResult
+ * only the hit actor, the quantized trace start (URPGLagCompensationSubsystem checks it), location and normal and the bone index are serialized
+ * the hit result is rebuilt from them when it's received so everything that reads GetHitResult keeps working
+ */
+USTRUCT()
+struct ACTIONRPG_API FRPGGameplayAbilityTargetData_LineTraceHit : public FGameplayAbilityTargetData
+{
+	GENERATED_BODY()
+
+	FRPGGameplayAbilityTargetData_LineTraceHit();
+
+	explicit FRPGGameplayAbilityTargetData_LineTraceHit(const FHitResult& InHitResult);
+
+	UPROPERTY()
+	TWeakObjectPtr<AActor> HitActor;
+
+	//1 unit precision is enough for the lag compensation tolerance
+	UPROPERTY()
+	FVector_NetQuantize TraceStart;
+
+	//where the trace hit, or the end of the trace if nothing was hit
+	UPROPERTY()
+	FVector_NetQuantize10 Location;
+
+	//only sent for blocking hits
+	UPROPERTY()
+	FVector_NetQuantizeNormal Normal;
+
+	//index of the hit bone in the hit actor's skeletal mesh (FindBoneMesh), INDEX_NONE if no bone was hit or the bone is on another mesh of the actor
+	UPROPERTY()
+	int16 BoneIndex;
+
+	UPROPERTY()
+	bool bBlockingHit;
+
+	virtual TArray<TWeakObjectPtr<AActor>> GetActors() const override;
+
+	virtual bool HasHitResult() const override { return true; }
+
+	virtual const FHitResult* GetHitResult() const override { return &HitResult; }
+
+	virtual bool HasOrigin() const override { return true; }
+
+	virtual FTransform GetOrigin() const override;
+
+	virtual bool HasEndPoint() const override { return true; }
+
+	virtual FVector GetEndPoint() const override { return Location; }
+
+	virtual UScriptStruct* GetScriptStruct() const override { return FRPGGameplayAbilityTargetData_LineTraceHit::StaticStruct(); }
+
+	virtual FString ToString() const override;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+protected:
+	//rebuilt from the serialized fields, never sent
+	FHitResult HitResult;
+
+	void RebuildHitResult();
+
+	//the mesh BoneIndex is resolved against on both sides, the first skinned mesh of the actor
+	static class USkinnedMeshComponent* FindBoneMesh(const AActor* Actor);
+};
+
+template<>
+struct TStructOpsTypeTraits<FRPGGameplayAbilityTargetData_LineTraceHit> : public TStructOpsTypeTraitsBase2<FRPGGameplayAbilityTargetData_LineTraceHit>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
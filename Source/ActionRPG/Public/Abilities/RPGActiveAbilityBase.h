@@ -63,6 +63,9 @@ public:
 	//blueprint helper function to check if the ability owner is local controller
 	UFUNCTION(BlueprintCallable, Category = "Gameplay Ability", DisplayName = "IsLocalController")
 	bool K2_IsLocalController() const;
+
+	/** Prewarms the target actor pool with PrewarmTargetActorClass */
+	virtual void OnGiveAbility(const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilitySpec& Spec) override;
 	
 protected:
 	/*the game play effect that is applied on attack, this will be the same since it doesn't change from 1 instance of the same ability to another*/
@@ -105,8 +108,21 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Ability", meta = (EditCondition = "bDamageSetByCaller"))
 	float BaseDamage;
 
-	/**get the dynamic cool down tags of the input to which this ability is bound to and the AbilityCooldownTags*/
-	FGameplayTagContainer GetAdditionalCooldownTags() const;
+	/*when the target data contains at least this many targets, the armor of all the targets is evaluated in one batch (FRPGDamageBatch) instead of per target
+	 *the batch uses the same tags as the execution so the damage is the same either way, 0 to disable*/
+	UPROPERTY(EditDefaultsOnly, Category = "Ability", meta = (ClampMin = "0"))
+	int32 BatchedDamageMinTargets;
+
+	/*the target actor class this ability uses with WaitTargetData, the pool (URPGTargetActorPoolSubsystem) is filled with PrewarmTargetActorCount of them when the ability is given
+	 *so the first uses don't spawn one, only non replicated classes are pooled*/
+	UPROPERTY(EditDefaultsOnly, Category = "Ability")
+	TSubclassOf<class AGameplayAbilityTargetActor> PrewarmTargetActorClass;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Ability", meta = (ClampMin = "0"))
+	int32 PrewarmTargetActorCount;
+
+	/**get the dynamic cool down tags of the input to which this ability is bound to and the AbilityCooldownTags, cached until the input binding changes*/
+	const FGameplayTagContainer& GetAdditionalCooldownTags() const;
 
 	//Handle target data, this is something common for all game play abilities, this will apply effects like freeze, light fire to target, reflect damage etc..
 	//called by K2_ApplyDamageEffectToTargetData, just splitting the functionality from the blueprint node to make it more clear
@@ -133,4 +149,16 @@ private:
 	// This will be a union of our Dynamic CooldownTags and the cool down GE's cool down tags.
 	UPROPERTY()
 	FGameplayTagContainer InternalUnionCooldownTags;
+
+	//cached result of GetAdditionalCooldownTags, only rebuilt when the key below changes
+	mutable FGameplayTagContainer CachedAdditionalCooldownTags;
+
+	//the spec handle, inventory input binding serial and player controlled state the cache was built with
+	mutable FGameplayAbilitySpecHandle CachedCooldownSpecHandle;
+	mutable uint32 CachedCooldownInputBindingSerial;
+	mutable bool bCachedCooldownPlayerControlled;
+	mutable bool bCooldownTagsCached;
+
+	//rebuild the cached cool down tags if the spec or its input binding changed, the CDO is never cached since it's shared between specs
+	void UpdateCooldownTagsCache() const;
 };
@@ -4,8 +4,69 @@
 
 #include "CoreMinimal.h"
 #include "GameplayEffectExecutionCalculation.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
 #include "RPGDamageExecutionCalculation.generated.h"
 
+/**
+ * Armor mitigation for many targets evaluated in one pass, used by abilities that hit a lot of targets at once (cleave, explosions)
+ * the targets are stored as SoA so the multipliers can be computed in a tight loop, while the batch is active (FRPGScopedDamageBatch)
+ * URPGDamageExecutionCalculation uses the pre computed multiplier instead of evaluating the armor itself, but only for the spec the batch was made for
+ * so nested executions inside the scope (reflection, effects applied from the hit events) are calculated as usual
+ * the armor is evaluated with the same source and target tags as the execution would use, so the damage doesn't depend on the number of targets
+ * game thread only
+ */
+struct ACTIONRPG_API FRPGDamageBatch
+{
+	TArray<class UAbilitySystemComponent*> TargetAbilitySystems;
+	TArray<FGameplayTagContainer> TargetTags;
+	TArray<float> TargetArmor;
+	TArray<float> DamageMultipliers;
+
+	//ability system -> index into the arrays above
+	TMap<const class UAbilitySystemComponent*, int32> TargetIndices;
+
+	//the spec the batch is applied with, copies of it made for each target keep the same effect, ability and instigator
+	const class UGameplayEffect* SourceEffect = nullptr;
+	const class UGameplayAbility* SourceAbility = nullptr;
+	const class UAbilitySystemComponent* SourceAbilitySystem = nullptr;
+
+	//the source tags captured by the spec, the armor modifiers are evaluated with them
+	FGameplayTagContainer SourceTags;
+
+	//remember the spec the batch will be applied with, only executions of this spec use the batch
+	void SetSourceSpec(const FGameplayEffectSpec& Spec);
+
+	bool MatchesSpec(const FGameplayEffectSpec& Spec) const;
+
+	//add the unique targets with an ability system from the target data, returns the number of targets in the batch
+	int32 AddTargets(const FGameplayAbilityTargetDataHandle& TargetData);
+
+	//evaluate the armor of every target with the source and target tags and compute all the damage multipliers, call SetSourceSpec first
+	void Evaluate();
+
+	int32 Num() const { return TargetAbilitySystems.Num(); }
+
+	//multiplier for the target or nullptr if it's not part of the batch
+	const float* FindDamageMultiplier(const class UAbilitySystemComponent* TargetAbilitySystem) const;
+
+	//the batch currently being applied if it was made for the spec, nullptr otherwise
+	static const FRPGDamageBatch* FindActive(const FGameplayEffectSpec& Spec);
+
+private:
+	friend struct FRPGScopedDamageBatch;
+	static const FRPGDamageBatch* ActiveBatch;
+};
+
+/** sets the active damage batch for the scope, apply the damage effect to the targets inside this scope */
+struct ACTIONRPG_API FRPGScopedDamageBatch
+{
+	FRPGScopedDamageBatch(const FRPGDamageBatch& Batch);
+	~FRPGScopedDamageBatch();
+
+private:
+	const FRPGDamageBatch* PreviousBatch;
+};
+
 /**
  * 
  */
@@ -19,7 +80,19 @@ public:
 
 	virtual void Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, OUT FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const override;
 
+	//compute the damage multiplier for each armor value, armor is clamped to 0 the same way Execute does
+	static void CalculateArmorDamageMultipliers(const float* ArmorValues, float* OutMultipliers, int32 Num);
+
+	/**
+	 * the target's armor with the modifiers that apply for the tags, used by Execute and FRPGDamageBatch so both get the same value
+	 * the armor isn't in RelevantAttributesToCapture, the batched specs would capture it for nothing
+	 */
+	static float EvaluateArmor(class UAbilitySystemComponent* TargetAbilitySystem, const FAggregatorEvaluateParameters& EvaluationParameters);
+
 protected:
 
 	float CalculateArmorDamageMultiplier(float ArmorValue) const;
+
+	//Event.ReceiveHit to the target, sent once the damage of the execution is known
+	static void SendReceiveHitEvent(AActor* SourceActor, AActor* TargetActor, float UnmitigatedDamage);
 };
@@ -4,14 +4,63 @@
 
 #include "CoreMinimal.h"
 #include "Abilities/RPGActiveAbilityBase.h"
+#include "Abilities/GameplayAbilityTargetDataFilter.h"
+#include "Engine/EngineTypes.h"
 #include "RPGHitscanAbility.generated.h"
 
 /**
- * 
+ * Native hitscan ability, does the line trace directly instead of spawning ARPGAbilityTargetActor_SingleLineTrace through WaitTargetData
+ * the locally controlled side traces, sends the target data to the server in the activation prediction window, applies the damage (on authority) and ends
+ * the server waits for the client's target data if the ability is not locally controlled
  */
 UCLASS()
 class ACTIONRPG_API URPGHitscanAbility : public URPGActiveAbilityBase
 {
 	GENERATED_BODY()
-	
+
+public:
+	URPGHitscanAbility(const FObjectInitializer& ObjectInitializer);
+
+	virtual void ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData) override;
+
+	virtual void EndAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, bool bReplicateEndAbility, bool bWasCancelled) override;
+
+protected:
+	/*max range of the shot, same as the target actor's MaxRange*/
+	UPROPERTY(EditDefaultsOnly, Category = "Hitscan")
+	float MaxRange;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitscan")
+	FCollisionProfileName TraceProfile;
+
+	/*does the trace affect the aiming pitch*/
+	UPROPERTY(EditDefaultsOnly, Category = "Hitscan")
+	bool bTraceAffectsAimPitch;
+
+	/*socket on the avatar's mesh to trace from, traces from the avatar actor location if none*/
+	UPROPERTY(EditDefaultsOnly, Category = "Hitscan")
+	FName TraceStartSocketName;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitscan")
+	FGameplayTargetDataFilterHandle Filter;
+
+	/*called on the local client and the server with the target data before the damage is applied, use it for the cosmetics*/
+	UFUNCTION(BlueprintImplementableEvent, Category = "Hitscan", DisplayName = "OnHitscanTargetData")
+	void K2_OnHitscanTargetData(const FGameplayAbilityTargetDataHandle& TargetData);
+
+	//do the trace and build the target data, only on the locally controlled side
+	FGameplayAbilityTargetDataHandle PerformHitscan() const;
+
+	//apply the target data and end the ability
+	virtual void HandleTargetData(const FGameplayAbilityTargetDataHandle& TargetData);
+
+	//server callbacks for the target data sent by a remote client
+	void OnServerTargetDataReceived(const FGameplayAbilityTargetDataHandle& Data, FGameplayTag ActivationTag);
+	void OnServerTargetDataCancelled();
+
+	void ClearServerTargetDataDelegates();
+
+private:
+	FDelegateHandle ServerTargetDataSetHandle;
+	FDelegateHandle ServerTargetDataCancelledHandle;
 };
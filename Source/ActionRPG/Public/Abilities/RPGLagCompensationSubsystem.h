@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
+#include "RPGLagCompensationSubsystem.generated.h"
+
+class ARPGCharacterBase;
+struct FGameplayAbilityActorInfo;
+
+/** hitbox of a character at a point in time, the capsule is used as the hitbox */
+struct FRPGHitboxSnapshot
+{
+	float Time;
+	FVector Location;
+	FQuat Rotation;
+	float Radius;
+	float HalfHeight;
+
+	//distance from the point to the surface of the capsule, <= 0 when inside
+	float GetDistanceToPoint(const FVector& Point) const;
+
+	static FRPGHitboxSnapshot Interpolate(const FRPGHitboxSnapshot& A, const FRPGHitboxSnapshot& B, float Time);
+};
+
+/** fixed size ring buffer of the hitbox snapshots of one character, the oldest snapshot is overwritten */
+struct FRPGHitboxHistory
+{
+	TWeakObjectPtr<ARPGCharacterBase> Character;
+	//only used as the key in HistoryIndices, the weak pointer can't give it back once the character is gone
+	const ARPGCharacterBase* CharacterKey;
+
+	void Init(ARPGCharacterBase* InCharacter, int32 MaxSnapshots);
+
+	void Add(const FRPGHitboxSnapshot& Snapshot);
+
+	/**
+	 * get the hitbox at the time, interpolated between the two snapshots around it
+	 * @return false if there are no snapshots, the time is clamped to the oldest/newest snapshot
+	 */
+	bool GetAtTime(float Time, FRPGHitboxSnapshot& OutSnapshot) const;
+
+private:
+	TArray<FRPGHitboxSnapshot> Snapshots;
+
+	//index of the newest snapshot
+	int32 Head;
+	int32 Num;
+
+	const FRPGHitboxSnapshot& GetFromNewest(int32 Age) const
+	{
+		return Snapshots[(Head - Age + Snapshots.Num()) % Snapshots.Num()];
+	}
+};
+
+/**
+ * Server side lag compensation, records the hitbox of every ARPGCharacterBase each server frame
+ * the target data sent by clients is validated against the hitboxes rewound to the time the client saw them (GetClientViewTime)
+ * so the client keeps authority over the targeting but can't send hits on targets it could not have hit
+ * the tuning values are set in DefaultGame.ini, subsystems can't be edited in the editor
+ */
+UCLASS(Config = Game)
+class ACTIONRPG_API URPGLagCompensationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	URPGLagCompensationSubsystem();
+
+	void RegisterCharacter(ARPGCharacterBase* Character);
+
+	void UnregisterCharacter(ARPGCharacterBase* Character);
+
+	/**
+	 * check that the hit location is on the hitbox of the character at the time
+	 * @return true if the character has no history, i.e. it's not something we can validate
+	 */
+	bool ValidateHit(const ARPGCharacterBase* HitCharacter, const FVector& HitLocation, float Time) const;
+
+	/**
+	 * validate all the hit results in client sent target data, the hit characters are rewound to the instigating player's view time
+	 * @return false if any hit is not on the rewound hitbox of the hit character, or the trace started too far away from the instigator's current hitbox
+	 */
+	bool ValidateTargetData(const FGameplayAbilityTargetDataHandle& TargetData, const FGameplayAbilityActorInfo* ActorInfo) const;
+
+	//the server time of the other characters the client was seeing when it sent data now, half the round trip plus the interpolation delay ago
+	float GetClientViewTime(const FGameplayAbilityActorInfo* ActorInfo) const;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+protected:
+	UPROPERTY(Config)
+	bool bEnabled;
+
+	//number of snapshots kept per character (at least 2), at 60hz 32 snapshots covers just over half a second
+	UPROPERTY(Config)
+	int32 MaxSnapshots;
+
+	//max time to rewind, anyone with a higher ping is validated against the oldest snapshot
+	UPROPERTY(Config)
+	float MaxRewindTime;
+
+	//how far behind the latest received state the clients show the simulated characters, the movement component smooths over NetworkSimulatedSmoothLocationTime
+	UPROPERTY(Config)
+	float ClientInterpolationDelay;
+
+	//how far outside of the rewound capsule the hit can be, covers the interpolation error and the mesh sticking out of the capsule
+	UPROPERTY(Config)
+	float HitTolerance;
+
+	//how far the trace start can be from the instigator's current hitbox, the instigator is autonomous so it isn't behind the server like the other characters
+	UPROPERTY(Config)
+	float MaxTraceStartDistance;
+
+private:
+	TArray<FRPGHitboxHistory> Histories;
+
+	//character to index into Histories
+	TMap<const ARPGCharacterBase*, int32> HistoryIndices;
+
+	void RecordSnapshots();
+
+	//swap the last history into the slot and fix its index
+	void RemoveHistoryAt(int32 Index);
+
+	static bool MakeSnapshot(const ARPGCharacterBase* Character, float Time, FRPGHitboxSnapshot& OutSnapshot);
+};
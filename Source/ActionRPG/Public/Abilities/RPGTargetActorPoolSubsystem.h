@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RPGTargetActorPoolSubsystem.generated.h"
+
+class AGameplayAbilityTargetActor;
+
+USTRUCT()
+struct FRPGTargetActorPoolList
+{
+	GENERATED_BODY()
+
+	//actors that are not being used by any task
+	UPROPERTY()
+	TArray<AGameplayAbilityTargetActor*> FreeActors;
+};
+
+/**
+ * Per world pool of target actors keyed by class, used by URPGAbilityTask_WaitTargetData so the instant traces don't spawn and destroy an actor on every attack
+ * only non replicated target actors are pooled, a replicated one would stay relevant to the clients while sitting in the pool
+ * MaxFreeActorsPerClass is set in DefaultGame.ini, subsystems can't be edited in the editor
+ */
+UCLASS(Config = Game)
+class ACTIONRPG_API URPGTargetActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	URPGTargetActorPoolSubsystem();
+
+	static bool CanPoolClass(TSubclassOf<AGameplayAbilityTargetActor> Class);
+
+	/**
+	 * take an actor out of the pool, if there is none a new one is spawned deferred
+	 * pooled actors tick again as they did when they were spawned
+	 * @param bOutNeedsFinishSpawning true if the actor was just spawned and FinishSpawning still has to be called on it
+	 */
+	AGameplayAbilityTargetActor* AcquireActor(TSubclassOf<AGameplayAbilityTargetActor> Class, bool& bOutNeedsFinishSpawning);
+
+	/**
+	 * return an actor to the pool, the caller has to clear any delegates it bound to the actor
+	 * the actor is destroyed instead if the pool for its class is already full
+	 */
+	void ReleaseActor(AGameplayAbilityTargetActor* TargetActor);
+
+	//spawn actors up front so the first attacks don't spawn either, called by URPGActiveAbilityBase when it's given
+	void Prewarm(TSubclassOf<AGameplayAbilityTargetActor> Class, int32 Count);
+
+protected:
+	//max number of free actors kept per class, more than this can be in use at once but the extra ones are destroyed when released
+	UPROPERTY(Config)
+	int32 MaxFreeActorsPerClass;
+
+	AGameplayAbilityTargetActor* SpawnActorDeferred(TSubclassOf<AGameplayAbilityTargetActor> Class) const;
+
+private:
+	UPROPERTY()
+	TMap<UClass*, FRPGTargetActorPoolList> Pools;
+};
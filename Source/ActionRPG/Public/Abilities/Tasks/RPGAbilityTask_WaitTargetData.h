@@ -14,6 +14,7 @@
 
 /**
  * Waits for TargetData from an already spawned TargetActor and does *NOT* destroy it when it receives data when used with WaitTargetDataReusableActor
+ * WaitTargetData takes non replicated target actors from URPGTargetActorPoolSubsystem and returns them when the task ends instead of spawning/destroying one every time
  */
 UCLASS(notplaceable)
 class ACTIONRPG_API URPGAbilityTask_WaitTargetData : public UAbilityTask
@@ -73,6 +74,9 @@ protected:
 
 	virtual void OnDestroy(bool AbilityEnded) override;
 
+	//unbind the task and the ability system from the target actor so it can be used again
+	void ClearTargetActorCallbacks();
+
 	bool ShouldReplicateDataToServer() const;
 
 protected:
@@ -84,6 +88,12 @@ protected:
 
 	bool bReusableActor;
 
+	/** TargetActor came from the URPGTargetActorPoolSubsystem and is returned to it when the task ends */
+	bool bPooledActor;
+
+	/** the pooled actor was newly spawned deferred and still needs FinishSpawning */
+	bool bPooledActorNeedsFinishSpawning;
+
 	/** The TargetActor that we spawned */
 	UPROPERTY()
 	AGameplayAbilityTargetActor* TargetActor;
@@ -4,10 +4,58 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "Character/RPGSignificance.h"
 #include "RPGAnimInstanceBase.generated.h"
 
+/** what the locomotion update needs from the character, gathered on the game thread so the update itself doesn't touch any actor */
+struct FRPGLocomotionSnapshot
+{
+	FVector Velocity;
+	FRotator ActorRotation;
+	bool bIsFalling;
+	int32 JumpCurrentCount;
+
+	FRPGLocomotionSnapshot()
+		: Velocity(FVector::ZeroVector), ActorRotation(FRotator::ZeroRotator), bIsFalling(false), JumpCurrentCount(0)
+	{
+	}
+};
+
+/**
+ * Proxy for URPGAnimInstanceBase, PreUpdate gathers the snapshot on the game thread and Update evaluates the locomotion vars
+ * Update runs on a worker thread when the anim blueprint uses multi threaded animation update, right before the anim graph so the graph sees this frame's values
+ */
+USTRUCT()
+struct ACTIONRPG_API FRPGAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	FRPGAnimInstanceProxy()
+		: FAnimInstanceProxy(), RPGAnimInstance(nullptr), bHasLocomotionSnapshot(false), LocomotionDeltaSeconds(0.0f)
+	{
+	}
+
+	FRPGAnimInstanceProxy(UAnimInstance* InAnimInstance);
+
+protected:
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+	virtual void Update(float DeltaSeconds) override;
+
+private:
+	class URPGAnimInstanceBase* RPGAnimInstance;
+
+	FRPGLocomotionSnapshot LocomotionSnapshot;
+
+	//the significance interval elapsed and a snapshot was gathered this frame
+	bool bHasLocomotionSnapshot;
+
+	float LocomotionDeltaSeconds;
+};
+
 /**
- * 
+ * base anim instance, the locomotion vars are computed in FRPGAnimInstanceProxy::Update so they can be computed off the game thread
+ * they are written from the anim update (possibly a worker thread), so only read them from the anim graph
  */
 UCLASS()
 class ACTIONRPG_API URPGAnimInstanceBase : public UAnimInstance
@@ -22,7 +70,13 @@ public:
 
 	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
 
+	//set by URPGSignificanceSubsystem, picks the locomotion update interval
+	void SetSignificance(ERPGSignificance NewSignificance);
+
 protected:
+	friend struct FRPGAnimInstanceProxy;
+
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
 
 	class ACharacter* OwnerCharacter;
 
@@ -63,7 +117,25 @@ protected:
 	//keep track of the jump count, if the number of jump count is different between frames that means the char jumped (only if it increases)
 	int32 JumpCount;
 
-	void UpdateLocomotionVars(float DeltaSeconds);
+	//game thread, copy what the locomotion update needs from the owner character
+	void GatherLocomotionSnapshot(FRPGLocomotionSnapshot& OutSnapshot) const;
+
+	//any thread, only reads the snapshot and writes the locomotion vars of this instance
+	void UpdateLocomotionVars(const FRPGLocomotionSnapshot& Snapshot, float DeltaSeconds);
+
+	//seconds between UpdateLocomotionVars for each significance bucket, 0 updates every frame
+	UPROPERTY(EditDefaultsOnly, Category = "Locomotion|Significance")
+	float LocomotionUpdateInterval[(uint8)ERPGSignificance::MAX];
+
+	//seconds between UpdateLocomotionVars on a dedicated server, nothing is rendered there so the locomotion only needs to be roughly right
+	UPROPERTY(EditDefaultsOnly, Category = "Locomotion|Significance")
+	float DedicatedServerLocomotionUpdateInterval;
+
+	//the interval currently in use
+	float CurrentLocomotionUpdateInterval;
+
+	//time since the last locomotion update, passed as the delta to UpdateLocomotionVars, only touched on the game thread
+	float LocomotionTimeSinceUpdate;
 
 	//ANIMATION OVERRIDES FOR CHARACTER/WEAPON
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Upper Body")
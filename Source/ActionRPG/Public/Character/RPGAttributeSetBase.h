@@ -5,17 +5,28 @@
 #include "CoreMinimal.h"
 #include "AttributeSet.h"
 #include "AbilitySystemComponent.h"
+#include "Net/Core/PushModel/PushModel.h"
 #include "RPGAttributeSetBase.generated.h"
 
+// GAMEPLAYATTRIBUTE_VALUE_INITTER writes the value directly, mark the push model property dirty as well
+#define RPG_ATTRIBUTE_VALUE_INITTER(ClassName, PropertyName) \
+	FORCEINLINE void Init##PropertyName(float NewVal) \
+	{ \
+		PropertyName.SetBaseValue(NewVal); \
+		PropertyName.SetCurrentValue(NewVal); \
+		MARK_PROPERTY_DIRTY_FROM_NAME(ClassName, PropertyName, this); \
+	}
+
 // Uses macros from AttributeSet.h
 #define ATTRIBUTE_ACCESSORS(ClassName, PropertyName) \
 		GAMEPLAYATTRIBUTE_PROPERTY_GETTER(ClassName, PropertyName) \
 		GAMEPLAYATTRIBUTE_VALUE_GETTER(PropertyName) \
 		GAMEPLAYATTRIBUTE_VALUE_SETTER(PropertyName) \
-		GAMEPLAYATTRIBUTE_VALUE_INITTER(PropertyName)
+		RPG_ATTRIBUTE_VALUE_INITTER(ClassName, PropertyName)
 
 /**
  * #TODO move to Abilities
+ * the replicated attributes are push based, they are only compared when an attribute changes (PreAttributeChange, PostGameplayEffectExecute or Init)
  */
 UCLASS()
 class ACTIONRPG_API URPGAttributeSetBase : public UAttributeSet
@@ -52,7 +63,8 @@ public:
 	FGameplayAttributeData Damage;
 	ATTRIBUTE_ACCESSORS(URPGAttributeSetBase, Damage)
 
-	//virtual void PreAttributeChange(const FGameplayAttribute& Attribute, float& NewValue) override;
+	//called for every change of an attribute's current value, including the ones from duration effects, marks the attribute dirty
+	virtual void PreAttributeChange(const FGameplayAttribute& Attribute, float& NewValue) override;
 
 	/**
 	* Called just before a GameplayEffect is executed to modify the base value of an attribute. No more changes can be made.
@@ -61,7 +73,21 @@ public:
 	virtual void PostGameplayEffectExecute(const struct FGameplayEffectModCallbackData& Data) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
+	//players replicate their attributes to everyone, AI only to their owner which they don't have (simulated proxies use ARPGCharacterBase::HealthBarProxy)
+	//set by the owning character when possessed, server only
+	void SetReplicateToAll(bool bInReplicateToAll);
+
+	bool GetReplicateToAll() const { return bReplicateToAll; }
+
+	//apply the COND_Custom override of the attributes, called by the owning character's PreReplication with this set's tracker
+	void PreReplicationForOwner(IRepChangedPropertyTracker& ChangedPropertyTracker);
+
 protected:
+	//mark the push model property of a replicated attribute dirty, the meta attributes are ignored
+	void MarkAttributeDirty(const FGameplayAttribute& Attribute);
+
+	bool bReplicateToAll;
+
 	UFUNCTION()
 	void OnRep_MaxHealth(const FGameplayAttributeData& OldMaxHealth);
 
@@ -6,12 +6,31 @@
 #include "GameFramework/Character.h"
 #include "AbilitySystemInterface.h"
 #include "GameplayAbilitySpec.h"
+#include "AbilitySystemComponent.h"
 #include "Character/RPGInventoryComponent.h"
 #include "RPGCharacterBase.generated.h"
 
 /*Wrapper around OnAbilityEnded since it's not a dynamic delegate, cannot access FAbilityEndedData from blueprint so pass the individual data*/
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FRPGGameplayAbilityEndedDelegate, class UGameplayAbility*, AbilityThatEnded, FGameplayAbilitySpecHandle, AbilitySpecHandle, bool, bReplicateEndAbility, bool, bWasCancelled);
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FRPGHealthBarProxyChangedDelegate, class ARPGCharacterBase*, Character);
+
+/**
+ * what simulated proxies of AI need for a health bar, replicated instead of the attribute set which AI don't replicate
+ * 1 byte instead of the attribute set and the gameplay effects, the state tags come with the ability system's minimal replication tags
+ */
+USTRUCT()
+struct FRPGHealthBarProxy
+{
+	GENERATED_BODY()
+
+	//Health / MaxHealth, 0-255
+	UPROPERTY()
+	uint8 HealthFraction;
+
+	FRPGHealthBarProxy() : HealthFraction(255) {}
+};
+
 UCLASS(config=Game)
 class ARPGCharacterBase : public ACharacter, public IAbilitySystemInterface
 {
@@ -60,8 +79,16 @@ public:
 
 	virtual void PostInitializeComponents() override;
 
+	/*register with the pawn spatial, significance and (on the server) lag compensation subsystems*/
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
+	//turns the attribute set replication on or off (it's a subobject so it has no PreReplication of its own), and the health bar proxy the other way
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
 	/*InitAbilityActorInfo for the server host (listen server) since this is only called on the server*/
 	virtual void PossessedBy(AController* NewController) override;
 
@@ -81,6 +108,18 @@ public:
 	UFUNCTION(BlueprintCallable)
 	virtual class URPGInventoryComponent* GetInventoryComponent() const { return InventoryComponent; };
 
+	//Health / MaxHealth, from the attribute set where it's replicated (server, owner and players) and from the health bar proxy on simulated proxies of AI
+	UFUNCTION(BlueprintCallable, Category = "Abilities")
+	float GetHealthFraction() const;
+
+	//@return true if the character has the tag, on simulated proxies only the tags replicated by the ability system are known
+	UFUNCTION(BlueprintCallable, Category = "Abilities")
+	bool HasStateTag(FGameplayTag Tag) const;
+
+	//called on simulated proxies of AI when the health bar proxy is replicated, players replicate their attributes instead
+	UPROPERTY(BlueprintAssignable)
+	FRPGHealthBarProxyChangedDelegate OnHealthBarProxyChanged;
+
 protected:
 	/** Called for forwards/backward input */
 	void MoveForward(float Value);
@@ -104,6 +143,33 @@ protected:
 	void NormalAttack();
 
 
+	//////////////////////////////////////////////////////////////////////////
+	//ABILITY SYSTEM REPLICATION
+	//////////////////////////////////////////////////////////////////////////
+
+	//replication mode of the ability system when possessed by an AI, nobody owns an AI so the gameplay effects only need to go out as tags and cues
+	UPROPERTY(EditDefaultsOnly, Category = "Abilities")
+	EGameplayEffectReplicationMode AIReplicationMode;
+
+	//replication mode of the ability system when possessed by a player
+	UPROPERTY(EditDefaultsOnly, Category = "Abilities")
+	EGameplayEffectReplicationMode PlayerReplicationMode;
+
+	UPROPERTY(ReplicatedUsing = OnRep_HealthBarProxy)
+	FRPGHealthBarProxy HealthBarProxy;
+
+	UFUNCTION()
+	virtual void OnRep_HealthBarProxy();
+
+	//bind to the health attributes, server only
+	void BindHealthBarProxy();
+
+	void OnHealthBarAttributeChanged(const FOnAttributeChangeData& Data);
+
+	//quantize the health and mark the proxy dirty if it changed
+	void UpdateHealthBarProxy();
+
+
 	//////////////////////////////////////////////////////////////////////////
 	//INVENTORY
 	//////////////////////////////////////////////////////////////////////////
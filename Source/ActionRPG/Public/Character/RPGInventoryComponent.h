@@ -6,6 +6,7 @@
 #include "Components/ActorComponent.h"
 #include "AbilitySystemComponent.h"
 #include "Abilities/GameplayAbility.h"
+#include "Engine/NetSerialization.h"
 #include "RPGInventoryComponent.generated.h"
 
 //enum used to bind the input to ability
@@ -21,7 +22,9 @@ enum class ERPGInventorySlot : uint8
 	//ability slot, these are ability that are invoked but the model cannot be equipped
 	ActiveItemSlot1		UMETA(DisplayName = "Active Item Slot 1"),
 	//ability slot, these are ability that are invoked but the model cannot be equipped
-	ActiveItemSlot2		UMETA(DisplayName = "Active Item Slot 2")
+	ActiveItemSlot2		UMETA(DisplayName = "Active Item Slot 2"),
+	//number of slots, used for sizing the slot lookup table
+	MAX					UMETA(Hidden)
 };
 
 UENUM(BlueprintType)
@@ -35,11 +38,17 @@ enum class ERPGAbilityInputID : uint8
 	// 3 Q
 	Ability1			UMETA(DisplayName = "Ability1"),
 	// 4 E
-	Ability2			UMETA(DisplayName = "Ability2")
+	Ability2			UMETA(DisplayName = "Ability2"),
+	//number of inputs, used for sizing the input lookup table
+	MAX					UMETA(Hidden)
 };
 
+struct FRPGInventorySlotArray;
+struct FRPGLooseInventoryArray;
+
+/*Slotted inventory entry, replicated as part of FRPGInventorySlotArray so only the changed slots are sent to the clients*/
 USTRUCT(BlueprintType)
-struct FRPGInventorySlotData
+struct FRPGInventorySlotData : public FFastArraySerializerItem
 {
 	GENERATED_BODY()
 
@@ -74,6 +83,113 @@ struct FRPGInventorySlotData
 		return (InSlot == Slot);
 	}
 
+	//FFastArraySerializerItem callbacks, only called on the clients
+	void PreReplicatedRemove(const FRPGInventorySlotArray& InArraySerializer);
+	void PostReplicatedAdd(const FRPGInventorySlotArray& InArraySerializer);
+	void PostReplicatedChange(const FRPGInventorySlotArray& InArraySerializer);
+};
+
+/*Fast array wrapper around the slotted inventory, each slot is delta replicated and the owning inventory component gets a callback per slot*/
+USTRUCT()
+struct FRPGInventorySlotArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FRPGInventorySlotData> Items;
+
+	//set in the inventory component constructor, not a UPROPERTY so it's not overwritten by the archetype
+	class URPGInventoryComponent* Owner;
+
+	FRPGInventorySlotArray()
+		: Owner(nullptr)
+	{
+
+	}
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FRPGInventorySlotData, FRPGInventorySlotArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FRPGInventorySlotArray> : public TStructOpsTypeTraitsBase2<FRPGInventorySlotArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/*Loose inventory entry, items that don't have a specific slot*/
+USTRUCT(BlueprintType)
+struct FRPGLooseInventoryData : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class ARPGInventoryItemBase* ItemActor;
+
+	FRPGLooseInventoryData()
+		: ItemActor(nullptr)
+	{
+
+	}
+
+	FRPGLooseInventoryData(class ARPGInventoryItemBase* InItemActor)
+		: ItemActor(InItemActor)
+	{
+
+	}
+
+	bool operator==(const FRPGLooseInventoryData& Other) const
+	{
+		return (ItemActor == Other.ItemActor);
+	}
+
+	bool operator==(const class ARPGInventoryItemBase* InItemActor) const
+	{
+		return (ItemActor == InItemActor);
+	}
+
+	//FFastArraySerializerItem callbacks, only called on the clients
+	void PreReplicatedRemove(const FRPGLooseInventoryArray& InArraySerializer);
+	void PostReplicatedAdd(const FRPGLooseInventoryArray& InArraySerializer);
+	void PostReplicatedChange(const FRPGLooseInventoryArray& InArraySerializer);
+};
+
+/*Fast array wrapper around the loose inventory*/
+USTRUCT()
+struct FRPGLooseInventoryArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FRPGLooseInventoryData> Items;
+
+	//set in the inventory component constructor, not a UPROPERTY so it's not overwritten by the archetype
+	class URPGInventoryComponent* Owner;
+
+	FRPGLooseInventoryArray()
+		: Owner(nullptr)
+	{
+
+	}
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FRPGLooseInventoryData, FRPGLooseInventoryArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FRPGLooseInventoryArray> : public TStructOpsTypeTraitsBase2<FRPGLooseInventoryArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
 };
 
 /*Ability slot handle, these are separate from the actual inventory item, since they will need to be recreated from the actual inventory slot actors when the owning actor dies
@@ -131,17 +247,19 @@ class ACTIONRPG_API URPGInventoryComponent : public UActorComponent
 
 	/*contains the abilities for the inventory slots, i.e only usable abilities and weapons, primary and secondary weapon included at the same time
 	 *use a variable i.e. CurrentWeaponSlot = weaponslot1 etc..
-	 *using a TArray instead of TMap since this needs to be replicated, use .Find with FRPGInventorySlot to find the corresponding ability and actor or
+	 *using a fast array instead of TMap since this needs to be replicated, use .Items.Find with FRPGInventorySlot to find the corresponding ability and actor or
 	 *use the ability handle to find which slot it's occupying, which then you can use to find the cool down tag on SlotCooldownTags etc
+	 *call MarkItemDirty/MarkArrayDirty after changing it so only the dirty slots are replicated
+	 *the replicated properties of the component are push based, MARK_PROPERTY_DIRTY_FROM_NAME after changing any of them
 	 */
-	UPROPERTY(ReplicatedUsing = OnRep_Inventory)
-	TArray<FRPGInventorySlotData> SlottedInventory;
+	UPROPERTY(Replicated)
+	FRPGInventorySlotArray SlottedInventory;
 
 	/*Inventory items that don't have a specific slot, and free, just includes a list of Inventory Items.
 	 *if they grant a ability you are not able to locate which item gave it except for the source object
 	 */
-	UPROPERTY(ReplicatedUsing = OnRep_Inventory)
-	TArray<ARPGInventoryItemBase*> LooseInventory;
+	UPROPERTY(Replicated)
+	FRPGLooseInventoryArray LooseInventory;
 
 	//the currently selected weapon slot, should only be either weapon slot 1 or weapon slot 2, cannot select any ability slots
 	//use switch weapons to change this
@@ -154,6 +272,30 @@ class ACTIONRPG_API URPGInventoryComponent : public UActorComponent
 
 	//#TODO bIsEquipping, no need to have a variable for each weapon
 
+	/*dense lookup tables indexed by the slot/input enum, kept in sync with SlottedInventory and AbilityInputHandles on both the server and the client
+	 *so the slot and input lookups don't need to scan the replicated arrays, never replicated
+	 */
+	UPROPERTY(Transient)
+	class ARPGInventoryItemBase* SlotItemTable[(uint8)ERPGInventorySlot::MAX];
+
+	FGameplayAbilitySpecHandle InputHandleTable[(uint8)ERPGAbilityInputID::MAX];
+
+	//reverse lookup for GetAbilityHandleInputID, which is called on every cool down check
+	TMap<FGameplayAbilitySpecHandle, ERPGAbilityInputID> SpecHandleInputMap;
+
+	//set the slot table entry, passing nullptr clears the slot
+	void SetSlotTableItem(ERPGInventorySlot Slot, class ARPGInventoryItemBase* Item);
+
+	//rebuild the input tables from AbilityInputHandles, used on the client when AbilityInputHandles is replicated
+	void RebuildInputHandleTables();
+
+	/*changed every time an ability is bound/unbound from an input or a weapon is equipped, abilities use this to know when to rebuild their cached cool down tags
+	 *taken from a global counter so two inventory components never share the same value
+	 */
+	uint32 InputBindingSerial;
+
+	void MarkInputBindingsChanged();
+
 
 public:	
 	// Sets default values for this component's properties
@@ -172,17 +314,30 @@ protected:
 	virtual void BeginPlay() override;
 
 	/*The ability handles that are created when item's are added to the slotted inventory*/
-	UPROPERTY(Replicated)
+	UPROPERTY(ReplicatedUsing = OnRep_AbilityInputHandles)
 	TArray<FRPGAbilityInputHandleData> AbilityInputHandles;
 
+	/** Called on owning client when AbilityInputHandles is replicated, rebuilds the input lookup tables*/
+	UFUNCTION()
+	virtual void OnRep_AbilityInputHandles();
+
 	//the cool down tag corresponding to each ability slot, if the tag or slot is empty from this list then there will be no cool down for that slot
 	//primary and secondary fire will not have cool downs since you should be able to swap weapons and fire instantly
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory", meta = (AllowPrivateAccess = "true"))
 	TMap<ERPGAbilityInputID, FGameplayTagContainer> AbilityInputCooldownTags;
 
-	/** Called on owning client when SlottedInventory or LooseInventory is replicated.*/
-	UFUNCTION()
-	virtual void OnRep_Inventory();
+	/** Called on clients when a slot is replicated, from the FRPGInventorySlotData fast array callbacks*/
+	virtual void OnSlottedItemAdded(const FRPGInventorySlotData& SlotData);
+	virtual void OnSlottedItemChanged(const FRPGInventorySlotData& SlotData);
+	virtual void OnSlottedItemRemoved(const FRPGInventorySlotData& SlotData);
+
+	/** Called on clients when a loose item is replicated, from the FRPGLooseInventoryData fast array callbacks*/
+	virtual void OnLooseItemAdded(const FRPGLooseInventoryData& LooseData);
+	virtual void OnLooseItemChanged(const FRPGLooseInventoryData& LooseData);
+	virtual void OnLooseItemRemoved(const FRPGLooseInventoryData& LooseData);
+
+	friend struct FRPGInventorySlotData;
+	friend struct FRPGLooseInventoryData;
 
 	/** Called on owning client when ActiveWeaponSlot is replicated.*/
 	UFUNCTION()
@@ -227,9 +382,6 @@ protected:
 	void SetCurrentWeapon(class ARPGInventoryItemBase* NewWeapon, class ARPGInventoryItemBase* LastWeapon = nullptr);
 
 public:	
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
-
 	/**
 	 * Add an item to the inventory
 	 * @param Item item to add to inventory
@@ -250,7 +402,7 @@ public:
 
 	//get the slotted inventory list
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
-	TArray<FRPGInventorySlotData> GetSlottedInventory() { return SlottedInventory; }
+	TArray<FRPGInventorySlotData> GetSlottedInventory() { return SlottedInventory.Items; }
 
 	//Get the item in the inventory slot
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
@@ -258,7 +410,7 @@ public:
 
 	//get the loose inventory list
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
-	TArray<ARPGInventoryItemBase*> GetLooseInventory() { return LooseInventory; }
+	TArray<ARPGInventoryItemBase*> GetLooseInventory() const;
 
 	//Get the slot which the gameplay ability is slotted to. used to find the cool down tag for the slot
 	//#TODO  maybe use the InputID already in the ability spec? unless setting that will cause issues
@@ -268,6 +420,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	FGameplayTagContainer GetAbilityInputCooldownTag(const ERPGAbilityInputID& InputID) const;
 
+	//returns a value that changes whenever the input bindings change, used for invalidating the ability cool down tag cache
+	uint32 GetInputBindingSerial() const { return InputBindingSerial; }
+
 	/**
 	 * Attempts to activate any ability in the specified item slot. Will return false if no activatable ability found or activation fails
 	 * Returns true if it thinks it activated, but it may return false positives due to failure later in activation.
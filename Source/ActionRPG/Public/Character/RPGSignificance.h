@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RPGSignificance.generated.h"
+
+/** significance buckets of a character, the significance manager value is the bucket as a float */
+UENUM(BlueprintType)
+enum class ERPGSignificance : uint8
+{
+	//not rendered recently
+	Hidden = 0,
+	Low,
+	Medium,
+	//close to the camera or locally controlled
+	High,
+	MAX UMETA(Hidden)
+};
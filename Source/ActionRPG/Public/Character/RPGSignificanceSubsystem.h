@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Character/RPGSignificance.h"
+#include "RPGSignificanceSubsystem.generated.h"
+
+class ARPGCharacterBase;
+
+/**
+ * Feeds the local player viewpoints to the USignificanceManager and buckets the characters registered with it by visibility and distance
+ * the bucket drives the update rate optimization (URO) frame skip of the mesh, the locomotion update rate of URPGAnimInstanceBase and whether hidden characters still tick their pose
+ * not created on a dedicated server, nothing is rendered there (the anim instance throttles itself instead)
+ * the thresholds are set in DefaultGame.ini, subsystems can't be edited in the editor
+ */
+UCLASS(Config = Game)
+class ACTIONRPG_API URPGSignificanceSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	URPGSignificanceSubsystem();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	void RegisterCharacter(ARPGCharacterBase* Character);
+
+	void UnregisterCharacter(ARPGCharacterBase* Character);
+
+	static const FName CharacterTag;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+protected:
+	//closer than this is High
+	UPROPERTY(Config)
+	float HighSignificanceDistance;
+
+	//closer than this is Medium, anything further is Low
+	UPROPERTY(Config)
+	float MediumSignificanceDistance;
+
+	//how recently the mesh must have been rendered to not be Hidden
+	UPROPERTY(Config)
+	float RenderedTolerance;
+
+	//frames the URO skips between anim evaluations of Medium and Low characters, High are evaluated every frame and Hidden use the engine's non rendered rate
+	UPROPERTY(Config)
+	int32 MediumAnimFrameSkip;
+
+	UPROPERTY(Config)
+	int32 LowAnimFrameSkip;
+
+	float CalculateSignificance(const ARPGCharacterBase* Character, const FTransform& Viewpoint) const;
+
+	//apply the new bucket to the mesh and the anim instance, bFinal when the character is unregistered
+	void ApplySignificance(ARPGCharacterBase* Character, ERPGSignificance Significance, bool bFinal) const;
+
+	//make the URO use the frame skip of the bucket for every LOD instead of picking a rate from the screen size
+	void ApplyUpdateRateParams(USkeletalMeshComponent* Mesh, ERPGSignificance Significance, bool bFinal) const;
+
+private:
+	//reused every frame
+	TArray<FTransform> Viewpoints;
+};
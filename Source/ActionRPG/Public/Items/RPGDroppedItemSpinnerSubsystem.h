@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "RPGDroppedItemSpinnerSubsystem.generated.h"
+
+class ARPGInventoryItemBase;
+
+/**
+ * Spins the turntable of every dropped ARPGInventoryItemBase in one loop, so the items themselves don't need to tick
+ * purely cosmetic, movement isn't replicated so this doesn't run on a dedicated server, items that were not rendered recently are skipped
+ * the tuning values are set in DefaultGame.ini, subsystems can't be edited in the editor
+ */
+UCLASS(Config = Game)
+class ACTIONRPG_API URPGDroppedItemSpinnerSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	URPGDroppedItemSpinnerSubsystem();
+
+	/**
+	 * start spinning the turntable around its parent, the current relative transform is used as the base and restored when removed
+	 * @param VisibilityComponent the turntable is only updated while this was recently rendered
+	 */
+	void AddItem(ARPGInventoryItemBase* Item, USceneComponent* Turntable, UPrimitiveComponent* VisibilityComponent);
+
+	void RemoveItem(ARPGInventoryItemBase* Item);
+
+	int32 GetNumItems() const { return Items.Num(); }
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+protected:
+	UPROPERTY(Config)
+	float SpinDegreesPerSecond;
+
+	//how recently the item must have been rendered to be updated
+	UPROPERTY(Config)
+	float RenderedTolerance;
+
+private:
+	struct FSpinningItem
+	{
+		TWeakObjectPtr<ARPGInventoryItemBase> Item;
+		//only used as the key in ItemIndices, the weak pointer can't give it back once the item is gone
+		const ARPGInventoryItemBase* ItemKey;
+		TWeakObjectPtr<USceneComponent> Turntable;
+		TWeakObjectPtr<UPrimitiveComponent> VisibilityComponent;
+		FVector BaseLocation;
+		FQuat BaseRotation;
+	};
+
+	TArray<FSpinningItem> Items;
+
+	//item to index into Items
+	TMap<const ARPGInventoryItemBase*, int32> ItemIndices;
+
+	//shared yaw of all the turntables
+	float SpinAngle;
+
+	void RemoveAt(int32 Index);
+};
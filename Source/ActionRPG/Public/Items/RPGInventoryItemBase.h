@@ -19,6 +19,9 @@ enum class ERPGItemType : uint8
 	Weapon				UMETA(DisplayName = "Weapon")
 };
 
+DECLARE_MULTICAST_DELEGATE_TwoParams(FRPGOnItemOwnerChanged, class ARPGInventoryItemBase* /*Item*/, class AActor* /*OldOwner*/);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FRPGOnItemEquipChanged, class ARPGInventoryItemBase* /*Item*/, class ARPGCharacterBase* /*EquippedAvatar, null when unequipped*/);
+
 UCLASS(abstract)
 class ACTIONRPG_API ARPGInventoryItemBase : public AActor
 {
@@ -51,12 +54,34 @@ public:
 
 	USkeletalMeshComponent* GetMesh() { return Mesh; }
 
+	//broadcasts OnItemOwnerChanged on the server, wakes the item so the new owner is replicated
+	virtual void SetOwner(AActor* NewOwner) override;
+
+	//held items are only relevant to their owner, equipped items whenever their avatar is
+	//only used by the legacy net driver, URPGReplicationGraph routes the items itself and never calls this
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	//server only, true while the item stays relevant to the non owners after being picked up so they receive the new owner and hide it
+	bool IsOwnerChangePending() const;
+
+	//server only, URPGReplicationGraph uses these to move the item between the spatial grid, the owner's connection and the avatar it's equipped on
+	static FRPGOnItemOwnerChanged OnItemOwnerChanged;
+	static FRPGOnItemEquipChanged OnItemEquipChanged;
+
 protected:
 
 	//is the item equipped on the owner pawn, this is set instead of getting if CurrentWeapon == this when we replicate the owner to the client
 	//since the owner might be getting replicated after the client gets the CurrentWeapon replicated
 	bool bIsEquipped;
 
+	//how long the item stays relevant to everyone that could see it after its owner changes, long enough for the woken item to be sent
+	//to them (and resent if the packet was lost) so OnRep_Owner hides it on their side before it becomes owner only
+	UPROPERTY(EditDefaultsOnly, Category = "Replication")
+	float OwnerChangeRelevancyTime;
+
+	//server world time of the last owner change
+	float LastOwnerChangeTime;
+
 	//the avatar that the weapon is attached to, set in OnEquip
 	//used in AttachmeshToPawn, this is also used for the collision etc, since the owner can be a player state
 	//UPROPERTY(ReplicatedUsing = OnRep_AvatarCharacter)
@@ -65,6 +90,11 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	//add/remove the turntable from URPGDroppedItemSpinnerSubsystem, spinning while the item is on the ground
+	void SetTurntableSpinning(bool bSpinning);
+
 	//use OnRep_Owner to know if the item was added the inventory or not
 	virtual void OnRep_Owner() override;
 
@@ -96,9 +126,6 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Ability", meta = (EditCondition = "ItemType == ERPGItemType::Weapon"))
 	TSubclassOf<class UGameplayAbility> SecondaryGameplayAbilityGranted;
 
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 	//function called when item is picked up and put into inventory, this is also called when the owner is replicated depending on the conditions
 	//#TODO might not have to call this again from the inventory component since we are using the owner to check if we have picked it up or not
 	//so calling OnPickup from GiveTo might work as well
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Items/RPGActiveAbilityActor.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
 #include "RPGMeleeWeaponActor.generated.h"
 
 UCLASS()
@@ -11,7 +12,7 @@ class ACTIONRPG_API ARPGMeleeWeaponActor : public ARPGActiveAbilityActor
 {
 	GENERATED_BODY()
 
-	/** Camera boom positioning the camera behind the character */
+	/** shape of the weapon hit box, it's never enabled for collision, the attack sweeps this capsule along the path the weapon moved each tick */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Weapon", meta = (AllowPrivateAccess = "true"))
 	class UCapsuleComponent* CollisionComponent;
 
@@ -19,26 +20,46 @@ public:
 	// Sets default values for this actor's properties
 	ARPGMeleeWeaponActor(const FObjectInitializer& ObjectInitializer);
 
-	//bind delegate to the collision capsule
-	virtual void PostInitializeComponents() override;
-
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-	//TSet of ignored actors, can't use ignore on move since you would have to add it to both components
+	//collision profile used for the sweeps, overlaps count as hits
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
+	FName SweepProfileName;
+
+	//max sweeps per tick, the path between ticks is split so no step moves the capsule more than its radius
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = "1"))
+	int32 MaxSweepSubsteps;
+
+	//TSet of ignored actors, so we won't hit the same actor twice in one swing
 	TSet<AActor*> IgnoredActors;
 
+	//is the attack window open, only on authority
+	bool bAttacking;
+
+	//capsule transform at the end of the last sweep
+	FTransform LastSweepTransform;
+
+	//hits of the last sweep that have not been sent yet
+	TArray<FHitResult> PendingHits;
+
+	//scratch array for the sweep results
+	TArray<FHitResult> SweepHits;
+
+	//sweep the capsule from LastSweepTransform to its current transform and add the new hits to PendingHits
+	void SweepWeapon();
+
+	//send an Event.Hit.Melee to the avatar for each pending hit, sent after the sweep since the events can end the attack
+	void SendPendingHits();
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
-	//being the weapon attack, enable weapon capsule collision
+	//begin the weapon attack, start sweeping the weapon capsule every tick (server only)
 	void BeginAttack();
 
-	//end the weapon attack, disable weapon capsule collision (animation might not be finished yet)
+	//end the weapon attack, sweep the rest of the path and send the hits (animation might not be finished yet)
 	void EndAttack();
-
-	UFUNCTION()
-	void OnBeginOverlap(class UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 };
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "RPGBenchmarkSubsystem.generated.h"
+
+class ARPGCharacterBase;
+class UGameplayAbility;
+
+/** what a benchmark run spawns and for how long, read from the command line by FromCommandLine */
+struct ACTIONRPG_API FRPGBenchmarkSettings
+{
+	//AI characters, possessed by their AIControllerClass (should be an ARPGAIController)
+	int32 NumAI;
+
+	//bots standing in for players, possessed by ARPGBenchmarkBotController
+	int32 NumBots;
+
+	TSubclassOf<ARPGCharacterBase> AIClass;
+
+	TSubclassOf<ARPGCharacterBase> BotClass;
+
+	//given to every AI with URPGAIBlueprintHelperLibrary::GiveAbility
+	TArray<TSubclassOf<UGameplayAbility>> AIAbilities;
+
+	//world seconds before the measuring starts, lets the spawning and the first path requests settle
+	float WarmupTime;
+
+	//world seconds measured, with -benchmark -fps=30 this is a fixed number of frames
+	float Duration;
+
+	//everything spawns on random reachable points this far from the first player start
+	float SpawnRadius;
+
+	//the summary is written to Saved/Profiling/RPGBenchmark/<Name>_<date>.csv
+	FString Name;
+
+	//request exit once the summary is written, for headless runs
+	bool bQuitWhenDone;
+
+	FRPGBenchmarkSettings();
+
+	/**
+	 * -RPGBenchmarkAI=100 -RPGBenchmarkBots=4 -RPGBenchmarkDuration=60 -RPGBenchmarkWarmup=5 -RPGBenchmarkRadius=3000 -RPGBenchmarkName=Horde
+	 * -RPGBenchmarkAIClass=/Game/Path/BP_Enemy.BP_Enemy_C -RPGBenchmarkBotClass=/Game/Path/BP_Player.BP_Player_C -RPGBenchmarkAbilities=/Game/Path/GA_A.GA_A_C+/Game/Path/GA_B.GA_B_C
+	 */
+	static FRPGBenchmarkSettings FromCommandLine();
+};
+
+/**
+ * AI stress benchmark, spawns AI and bot players, lets them fight for a fixed duration and writes frame time percentiles and GC counts as CSV
+ * started with -RPGBenchmark once the world has begun play, with the rpg.Benchmark [NumAI] [Duration] console command or by the ActionRPG.Benchmark automation test, only on the server
+ * the per category costs come from a CSV profiler capture over the same frames (Saved/Profiling/CSV)
+ * headless, with the ActionRPGServer target: ActionRPGServer <Map> -nullrhi -benchmark -fps=30 -RPGBenchmark -RPGBenchmarkAIClass=... -RPGBenchmarkQuit
+ * or as an automation test: UE4Editor-Cmd ActionRPG.uproject <Map> -server -nullrhi -benchmark -fps=30 -unattended -RPGBenchmarkAIClass=... -ExecCmds="Automation RunTests ActionRPG.Benchmark" -TestExit="Automation Test Queue Empty"
+ */
+UCLASS()
+class ACTIONRPG_API URPGBenchmarkSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	URPGBenchmarkSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	//@return false if a run is already going, this is a client or there's nothing to spawn
+	bool StartBenchmark(const FRPGBenchmarkSettings& InSettings);
+
+	bool IsRunning() const { return bRunning; }
+
+	//summary written by the last finished run, empty if none was written
+	const FString& GetLastSummaryPath() const { return LastSummaryPath; }
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+protected:
+	void SpawnCharacters();
+
+	ARPGCharacterBase* SpawnCharacter(TSubclassOf<ARPGCharacterBase> CharacterClass, const FVector& Center, bool bBot);
+
+	void BeginMeasuring();
+
+	void FinishBenchmark();
+
+	//@return the path of the summary, empty if it couldn't be written
+	FString WriteSummary() const;
+
+	void OnPreGarbageCollect();
+
+	void OnPostGarbageCollect();
+
+private:
+	FRPGBenchmarkSettings Settings;
+
+	//-RPGBenchmark was on the command line, start once the world has begun play
+	bool bAutoStartPending;
+
+	bool bRunning;
+
+	bool bMeasuring;
+
+	//world time the run started and the measuring started
+	float StartTime;
+	float MeasureStartTime;
+
+	//wall clock milliseconds of every measured frame
+	TArray<float> FrameTimes;
+
+	double LastFrameSeconds;
+
+	int32 NumGarbageCollections;
+
+	double GarbageCollectionStartSeconds;
+
+	double GarbageCollectionMilliseconds;
+
+	TArray<TWeakObjectPtr<AActor>> SpawnedActors;
+
+	FString LastSummaryPath;
+
+	FDelegateHandle PreGarbageCollectHandle;
+	FDelegateHandle PostGarbageCollectHandle;
+};
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+
+/**
+ * Native gameplay tags used by the module, resolved once in URPGEngineSubsystem::Initialize so the hot paths don't need to call RequestGameplayTag
+ * constructors run before the subsystem (CDOs) call InitializeNativeTags themselves, it only resolves the tags the first time
+ * every tag here must exist in DefaultGameplayTags.ini, InitializeNativeTags will stop the game if one is missing
+ */
+struct ACTIONRPG_API FRPGGameplayTags
+{
+	//SetByCaller damage magnitude
+	static FGameplayTag Data_Damage;
+
+	//SetByCaller cool down duration
+	static FGameplayTag Data_CooldownDuration;
+
+	//sent to the actor that was hit, with the unmitigated damage as the magnitude
+	static FGameplayTag Event_ReceiveHit;
+
+	//sent to the owner of a melee weapon when it hits something
+	static FGameplayTag Event_Hit_Melee;
+
+	//input slot cool downs, the defaults of URPGInventoryComponent::AbilityInputCooldownTags
+	static FGameplayTag Cooldown_Input_Ability1;
+	static FGameplayTag Cooldown_Input_Ability2;
+
+	//resolve all the tags, does nothing if they were already resolved
+	static void InitializeNativeTags();
+
+private:
+	static bool bInitialized;
+
+	static void AddTag(FGameplayTag& OutTag, const ANSICHAR* TagName, TArray<FString>& OutMissingTags);
+};
@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "RPGReplicationGraph.generated.h"
+
+class ARPGInventoryItemBase;
+class ARPGCharacterBase;
+class URPGReplicationGraphNode_AlwaysRelevant_ForConnection;
+
+/** how the actors of a class are routed to the graph nodes, the most derived class with a policy wins */
+UENUM()
+enum class ERPGClassRepNodeMapping : uint8
+{
+	//not in any node, replicated through another actor or a node that finds them itself (player states, player controllers)
+	NotRouted,
+	RelevantAllConnections,
+	//only relevant to the connection of their owner
+	RelevantOwnerConnection,
+	//in the spatial grid and never move
+	Spatialize_Static,
+	//in the spatial grid, the grid updates their cells every frame
+	Spatialize_Dynamic,
+	//static while dormant, dynamic while awake
+	Spatialize_Dormancy,
+	//ARPGInventoryItemBase, in the spatial grid while on the ground and shortly after being picked up, relevant to the owner's connection while in a player's inventory
+	//and replicated with the avatar while equipped
+	InventoryItem
+};
+
+/**
+ * replication graph, replaces the per actor per connection relevancy checks of the net driver
+ * pawns and dropped items are in a 2D spatial grid so each connection only gathers the cells around its viewer
+ * the viewer's controller, pawn, player state and the items in its inventory are gathered by a node per connection
+ * the other player states are replicated a few per frame by the player state frequency limiter
+ * enabled with ReplicationDriverClassName in DefaultEngine.ini
+ */
+UCLASS(Transient, Config = Engine)
+class ACTIONRPG_API URPGReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	URPGReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RemoveClientConnection(UNetConnection* NetConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+	virtual void BeginDestroy() override;
+
+protected:
+	//size of a spatial grid cell, actors are gathered from the cells within their cull distance of the viewer
+	UPROPERTY(Config)
+	float SpatialGridCellSize;
+
+	//the grid starts at this corner, the world is expected to be within a few hundred cells of it
+	UPROPERTY(Config)
+	FVector2D SpatialGridBias;
+
+	//other player states replicated per frame, the connection's own player state is replicated every frame
+	UPROPERTY(Config)
+	int32 PlayerStatesPerFrame;
+
+	//fall back for the classes with a net update frequency of 0
+	UPROPERTY(Config)
+	float DefaultNetUpdateFrequency;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_PlayerStateFrequencyLimiter* PlayerStateFrequencyLimiter;
+
+	UPROPERTY()
+	TMap<UNetConnection*, URPGReplicationGraphNode_AlwaysRelevant_ForConnection*> ConnectionNodes;
+
+	TClassMap<ERPGClassRepNodeMapping> ClassRepNodePolicies;
+
+	ERPGClassRepNodeMapping GetMappingPolicy(UClass* Class);
+
+	//the policy of a class without an explicit one
+	ERPGClassRepNodeMapping InferMappingPolicy(UClass* Class) const;
+
+	URPGReplicationGraphNode_AlwaysRelevant_ForConnection* GetConnectionNode(const AActor* Actor) const;
+
+	//add/remove an owner relevant actor or an inventory item to the node it should be in right now
+	void AddOwnedActor(AActor* Actor);
+	void RemoveOwnedActor(AActor* Actor);
+
+	void OnItemOwnerChanged(ARPGInventoryItemBase* Item, AActor* OldOwner);
+
+	void OnItemEquipChanged(ARPGInventoryItemBase* Item, ARPGCharacterBase* EquippedAvatar);
+
+private:
+	enum class EOwnedActorRoute : uint8
+	{
+		None,
+		Grid,
+		Connection,
+		//owned by a remote player whose connection isn't known yet, retried every frame
+		Pending
+	};
+
+	struct FOwnedActorRoute
+	{
+		EOwnedActorRoute Route;
+		TWeakObjectPtr<URPGReplicationGraphNode_AlwaysRelevant_ForConnection> ConnectionNode;
+		//the pawn an item is replicated with while equipped
+		TWeakObjectPtr<AActor> EquippedAvatar;
+
+		FOwnedActorRoute() : Route(EOwnedActorRoute::None) {}
+	};
+
+	TMap<TWeakObjectPtr<AActor>, FOwnedActorRoute> OwnedActorRoutes;
+
+	//rerouted every frame, the Pending route and the picked up items kept in the grid while ARPGInventoryItemBase::IsOwnerChangePending
+	TArray<TWeakObjectPtr<AActor>> PendingOwnedActors;
+
+	FDelegateHandle ItemOwnerChangedHandle;
+	FDelegateHandle ItemEquipChangedHandle;
+};
+
+/**
+ * gathered for a single connection, the viewer's controller, view target and player state every frame
+ * and the actors added with NotifyAddNetworkActor, the items in the player's inventory and the owner relevant actors
+ */
+UCLASS()
+class ACTIONRPG_API URPGReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode_ActorList
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+private:
+	//kept in ReplicationActorList until the viewer changes, only compared against so they don't need to keep the actors alive
+	AActor* LastViewer = nullptr;
+	AActor* LastViewTarget = nullptr;
+	AActor* LastPlayerState = nullptr;
+
+	void UpdateViewerActor(AActor* NewActor, AActor*& LastActor);
+};
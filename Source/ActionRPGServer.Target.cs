@@ -0,0 +1,17 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class ActionRPGServerTarget : TargetRules
+{
+	public ActionRPGServerTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		DefaultBuildSettings = BuildSettingsVersion.V2;
+		//push model changes the engine build, which needs a unique build environment and so a source engine
+		BuildEnvironment = TargetBuildEnvironment.Unique;
+		bWithPushModel = true;
+		ExtraModuleNames.Add("ActionRPG");
+	}
+}